@@ -0,0 +1,241 @@
+// Contains main()
+// Compares configurations of the scheduler on seeded layouts, for as long
+// as it takes the 95% confidence intervals to be as narrow as asked
+// Usage: ab_bench run <config> [win width] [latency width] [seconds] [seed]
+//        ab_bench ab <config> <config> [win width] [latency width]
+//            [seconds] [seed]
+//     config -- see make_config()
+//     the rest -- see Target
+// "run" plays one configuration and "ab" two, each on the same sequence of
+// layouts, until the intervals are narrow enough or time runs out. The
+// layout of game g is drawn from the seed sequence (seed, g).
+#include "generator.h"
+#include "running.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+using namespace Holy;
+
+namespace {
+    // A scheduler built from a spec: "adaptive" or "fixed", then "-name" for
+    // each stage to leave out, as in "adaptive-window-felix"
+    struct Config {
+        std::string spec;
+        Advice advice;
+        std::unique_ptr<Scheduler> sched;
+    };
+
+    std::unique_ptr<Config> make_config(const std::string& spec) {
+        auto ret = std::make_unique<Config>();
+        ret->spec = spec;
+        const auto dash = spec.find('-');
+        const std::string policy = spec.substr(0, dash);
+        if (policy != "adaptive" && policy != "fixed")
+            throw std::invalid_argument("Unknown policy: " + policy);
+        ret->sched = std::make_unique<Scheduler>(policy == "fixed"
+                ? Scheduler::Policy::fixed
+                : Scheduler::Policy::adaptive);
+        Scheduler all;
+        add_solvers(all, ret->advice);
+        std::vector<std::string> left_out;
+        for (auto i = dash; i != std::string::npos;) {
+            const auto next = spec.find('-', i + 1);
+            left_out.push_back(spec.substr(i + 1, next - i - 1));
+            i = next;
+        }
+        for (const auto& name : left_out) {
+            if (all.find(name) < 0)
+                throw std::invalid_argument("Unknown stage: " + name);
+        }
+        for (int i = 0; i < all.size(); i++) {
+            const auto& stage = all.stage(i);
+            if (std::find(left_out.begin(), left_out.end(), stage.name)
+                == left_out.end())
+                ret->sched->add(stage);
+        }
+        return ret;
+    }
+
+    // What a game played by a configuration came to
+    struct Outcome {
+        bool won;
+        // Moves made by the stages, and the time per move in ns, if any move
+        long long moves;
+        double move_ns;
+        // The bucket of 3BV of the board, see bbbv_bounds
+        int bucket;
+    };
+
+    Outcome play_layout(
+        Butterfly& butt, Scheduler& sched, const Checklist& mined) {
+        using namespace std::chrono;
+        long long fired = 0;
+        for (int i = 0; i < sched.size(); i++)
+            fired -= sched.stats(i).fired;
+        butt.measure(true);
+        const auto start = steady_clock::now();
+        butt.start_game({ 10, 10 }, mined);
+        GameData game;
+        game.mark_semiknown({ 10, 10 });
+        accio(game, butt, true);
+        sched.solve(game, butt);
+        const double ns =
+            duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        for (int i = 0; i < sched.size(); i++)
+            fired += sched.stats(i).fired;
+        return { butt.verify(), fired, fired > 0 ? ns / fired : 0,
+            bbbv_bucket(*butt.metrics()) };
+    }
+
+    // Stops a run once both intervals are this narrow, or the time is up
+    struct Target {
+        // Full width of the interval of the win rate, or of its difference
+        double win_width = 0.02;
+        // Full width of the interval of the time per move, or of its
+        // difference, relative to the mean time per move
+        double latency_width = 0.02;
+        double seconds = 600;
+        unsigned seed = 20201;
+        // Games before the intervals are trusted
+        long long min_games = 100;
+    };
+
+    // Whether a run may stop, given its intervals and the mean time per move
+    bool narrow_enough(const Target& target, const Running& win,
+        const Running& latency, double move_ns) {
+        return win.n >= target.min_games
+            && 2 * win.half_width() <= target.win_width
+            && 2 * latency.half_width() <= target.latency_width * move_ns;
+    }
+
+    // A Running per bucket of 3BV, so the easy boards, which are most of them,
+    // do not hide what happens on the hard ones
+    using Buckets = std::array<Running, bbbv_bounds.size() + 1>;
+
+    void run_one(const std::string& spec, const Target& target) {
+        using namespace std::chrono;
+        const auto config = make_config(spec);
+        const auto deadline = steady_clock::now()
+            + duration_cast<steady_clock::duration>(
+                duration<double>(target.seconds));
+        Butterfly butt;
+        Running win, latency;
+        Buckets bucket_win, bucket_latency;
+        while (!narrow_enough(target, win, latency, latency.mean)
+            && steady_clock::now() < deadline) {
+            std::seed_seq seq{ target.seed, (unsigned)win.n };
+            std::mt19937 rng(seq);
+            const auto o =
+                play_layout(butt, *config->sched, draw_layout({ 10, 10 }, rng));
+            win.add(o.won);
+            bucket_win[o.bucket].add(o.won);
+            if (o.moves > 0) {
+                latency.add(o.move_ns);
+                bucket_latency[o.bucket].add(o.move_ns);
+            }
+        }
+        std::cout << spec << ": " << win.n << " games\n";
+        write_interval(std::cout, "    win rate ", win);
+        write_interval(std::cout, "\n    ns per move ", latency);
+        std::cout << '\n';
+        for (std::size_t i = 0; i < bucket_win.size(); i++) {
+            std::cout << "    3BV " << bbbv_range(i) << ": " << bucket_win[i].n
+                      << " games";
+            write_interval(std::cout, "    win rate ", bucket_win[i]);
+            write_interval(std::cout, "    ns per move ", bucket_latency[i]);
+            std::cout << '\n';
+        }
+    }
+
+    void run_ab(const std::string& spec_a, const std::string& spec_b,
+        const Target& target) {
+        using namespace std::chrono;
+        const auto a = make_config(spec_a), b = make_config(spec_b);
+        const auto deadline = steady_clock::now()
+            + duration_cast<steady_clock::duration>(
+                duration<double>(target.seconds));
+        Butterfly butt;
+        // B minus A, game by game
+        Running win_a, win_b, win, latency_a, latency;
+        Buckets bucket_latency_a, bucket_latency;
+        while (!narrow_enough(target, win, latency, latency_a.mean)
+            && steady_clock::now() < deadline) {
+            std::seed_seq seq{ target.seed, (unsigned)win.n };
+            std::mt19937 rng(seq);
+            const Checklist mined = draw_layout({ 10, 10 }, rng);
+            // Take turns going first, so neither gets the warmer caches
+            Outcome oa, ob;
+            if (win.n % 2 == 0) {
+                oa = play_layout(butt, *a->sched, mined);
+                ob = play_layout(butt, *b->sched, mined);
+            } else {
+                ob = play_layout(butt, *b->sched, mined);
+                oa = play_layout(butt, *a->sched, mined);
+            }
+            win_a.add(oa.won);
+            win_b.add(ob.won);
+            win.add((double)ob.won - oa.won);
+            if (oa.moves > 0 && ob.moves > 0) {
+                latency_a.add(oa.move_ns);
+                latency.add(ob.move_ns - oa.move_ns);
+                bucket_latency_a[oa.bucket].add(oa.move_ns);
+                bucket_latency[oa.bucket].add(ob.move_ns - oa.move_ns);
+            }
+        }
+        std::cout << "A " << spec_a << ", B " << spec_b << ": " << win.n
+                  << " paired games\n";
+        write_interval(std::cout, "    win rate A ", win_a);
+        write_interval(std::cout, "    B ", win_b);
+        write_interval(std::cout, "\n    B - A ", win);
+        std::cout << "    p " << win.p_value() << '\n';
+        write_interval(std::cout, "    ns per move A ", latency_a);
+        write_interval(std::cout, "    B - A ", latency);
+        std::cout << " (" << 100 * latency.mean / latency_a.mean << "%)    p "
+                  << latency.p_value() << '\n';
+        for (std::size_t i = 0; i < bucket_latency.size(); i++) {
+            const auto& a = bucket_latency_a[i];
+            const auto& d = bucket_latency[i];
+            std::cout << "    3BV " << bbbv_range(i) << ": " << d.n << " games";
+            write_interval(std::cout, "    ns per move A ", a);
+            write_interval(std::cout, "    B - A ", d);
+            std::cout << " (" << 100 * d.mean / a.mean << "%)    p "
+                      << d.p_value() << '\n';
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string mode = argc > 1 ? argv[1] : "";
+    const int first = mode == "run" ? 3 : 4;
+    if ((mode != "run" && mode != "ab") || argc < first) {
+        std::cerr << "Usage: ab_bench run <config> [win width] "
+                     "[latency width] [seconds] [seed]\n"
+                     "       ab_bench ab <config> <config> [win width] "
+                     "[latency width] [seconds] [seed]\n";
+        return 1;
+    }
+    Target target;
+    if (argc > first)
+        target.win_width = std::atof(argv[first]);
+    if (argc > first + 1)
+        target.latency_width = std::atof(argv[first + 1]);
+    if (argc > first + 2)
+        target.seconds = std::atof(argv[first + 2]);
+    if (argc > first + 3)
+        target.seed = std::strtoul(argv[first + 3], nullptr, 10);
+    try {
+        if (mode == "run")
+            run_one(argv[2], target);
+        else
+            run_ab(argv[2], argv[3], target);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
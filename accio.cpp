@@ -1,98 +1,72 @@
 #include "solvers.h"
+#include "trace.h"
 #include <cassert>
 // #include <iostream>
-#include <queue>
-#include <set>
 
-namespace {
-    using Uninit = std::set<Holy::Point>;
-    using namespace Holy;
-
-    // Does the clicking work at point p
-    // assumes that the block at p is semiknown, so it has its neighbors notified
-    // Doesn't modify uninit
-    bool do_click(GameData& game, Butterfly& butt, bool det, Point p) {
-        assert(game[p].status == Block::semiknown);
-        auto read = butt.click(p);
-        if (det && !read)
+namespace Holy {
+    bool accio(GameData& game, GameBackend& backend, bool det) {
+        const trace::Span span("accio");
+        // All the semiknown blocks go out in one batch
+        std::array<Point, col * row> batch;
+        const int n = accio_batch(game, batch.data());
+        if (n == 0)
+            return true;
+        std::array<Reveal, col * row> revealed;
+        const int cnt = backend.click(batch.data(), n, revealed.data());
+        if (det && cnt < 0)
             std::terminate();
-        if (!det && !read)
+        if (!det && cnt < 0)
+            // non det, error move
             return false;
-        // So now read contains a value
-        // Already updated neighbors' info, just pull in value
-        auto& block = game[p];
-        block.label = *read;
-        block.status = Block::number;
+        accio_apply(game, batch.data(), n, revealed.data(), cnt);
         return true;
     }
 
-    // When a new continent is discovered, do bfs
-    bool bfs(GameData& game, Butterfly& butt, bool det, Point p, Uninit& uninit) {
-        assert(game[p].status == Block::number);
-        assert(game[p].label == 0);
-        std::queue<Point> q;
-        // vis is set when elements are pushed into q
-        std::bitset<col* row + 5> vis = 0;
-        q.push(p);
-        vis[p.hash()] = true;
-        do {
-            // Current point under investigation
-            Point p = q.front();
-            q.pop();
-            // std::cerr << "Currently: " << p.x << ' ' << p.y << '\n';
-            // Mark it as semiknown if it is unknown
-            // if p is empty or semiknown, then p is not the initial point
-            if (game[p].status == Block::unknown) {
-                game.mark_semiknown(p);
-            }
-            // Read the data from p if it is not the initial point
-            if (game[p].status != Block::number) {
-                if (!do_click(game, butt, det, p))
-                    // non det, error move
-                    return false;
-            }
-            if (game[p].label == 0) {
-                // Continue expanding
-                p.for_each_nei8([&](Point np) {
-                    if (!vis[np.hash()]
-                        && (game[np].status == Block::unknown
-                            || game[np].status == Block::semiknown)) {
-                        q.push(np);
-                        vis[np.hash()] = true;
-                    }
-                });
-            } else {
-                // Another block to recount
-                uninit.insert(p);
+    int accio_batch(const GameData& game, Point* batch) noexcept {
+        int n = 0;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                Point p = { ix, iy };
+                if (game[p].status == Block::semiknown)
+                    batch[n++] = p;
             }
-        } while (!q.empty());
-        return true;
+        }
+        return n;
     }
-} // namespace
 
-namespace Holy {
-    bool accio(GameData& game, Butterfly& butt, bool det) {
-        Uninit uninit;
+    void accio_apply(
+        GameData& game,
+        const Point* batch,
+        int n,
+        const Reveal* revealed,
+        int cnt) {
+        // Blocks to recount, by hash: the clicked ones and the numbers
+        // around new continents. The 0s inside have nothing left to count.
+        Checklist uninit;
+        for (int i = 0; i < n; i++)
+            uninit[batch[i].hash()] = true;
+        for (int i = 0; i < cnt; i++) {
+            const Point p = revealed[i].p;
+            auto& block = game[p];
+            if (block.status == Block::number)
+                continue;
+            assert(block.status != Block::mine);
+            // New continents bring unknown blocks with them, notify their
+            // neighbors first
+            if (block.status == Block::unknown)
+                game.mark_semiknown(p);
+            block.label = revealed[i].label;
+            block.status = Block::number;
+            if (block.label)
+                uninit[p.hash()] = true;
+        }
+        // Now call recount for each in uninit
         for (int ix = 1; ix <= col; ix++) {
             for (int iy = 1; iy <= row; iy++) {
                 Point p = { ix, iy };
-                // only interested in those that are semiknown
-                if (game[p].status != Block::semiknown)
-                    continue;
-                uninit.insert(p);
-                if (do_click(game, butt, det, p) == false)
-                    return false;
-                // After this game[p].status == number
-                if (game[p].label)
-                    continue;
-                // New continent discovered
-                bfs(game, butt, det, p, uninit);
+                if (uninit[p.hash()])
+                    game.recount(p);
             }
         }
-        // Now call recount for each in uninit
-        for (auto p : uninit) {
-            game.recount(p);
-        }
-        return true;
     }
 } // namespace Holy
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "analysis.h"
+#include "generator.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+
+namespace {
+    using namespace Holy;
+
+    // Whether the unknown block at p borders a number
+    bool on_frontier(const GameData& game, Point p) noexcept {
+        bool found = false;
+        game.for_each_nei8(p, [&](Point np) {
+            found = found || game[np].status == Block::number;
+        });
+        return found;
+    }
+} // namespace
+
+namespace Holy {
+    namespace query {
+        void encode(const GameData& game, Request& request) noexcept {
+            request.mines_left = (std::uint16_t)game.mines_left;
+            request.reserved = 0;
+            std::fill(std::begin(request.board), std::end(request.board), 0);
+            for (int iy = 1; iy <= row; iy++) {
+                for (int ix = 1; ix <= col; ix++) {
+                    const Point p{ ix, iy };
+                    const Block& block = game[p];
+                    std::uint8_t code = unknown_code;
+                    if (block.status == Block::number)
+                        code = block.label;
+                    else if (block.status == Block::mine)
+                        code = mine_code;
+                    const int h = (iy - 1) * col + ix - 1;
+                    request.board[h / 2] |= code << (h % 2 * 4);
+                }
+            }
+        }
+
+        bool decode(const Request& request, GameData& game) noexcept {
+            if (request.mines_left > mines)
+                return false;
+            game = GameData();
+            game.mines_left = request.mines_left;
+            for (int iy = 1; iy <= row; iy++) {
+                for (int ix = 1; ix <= col; ix++) {
+                    const Point p{ ix, iy };
+                    const int h = (iy - 1) * col + ix - 1;
+                    const int code = request.board[h / 2] >> (h % 2 * 4) & 15;
+                    Block& block = game[p];
+                    if (code <= 8) {
+                        block.status = Block::number;
+                        block.label = code;
+                    } else if (code == mine_code) {
+                        block.status = Block::mine;
+                    } else if (code != unknown_code) {
+                        return false;
+                    }
+                }
+            }
+            game.recount();
+            return true;
+        }
+
+        bool send(int fd, const Request& request) {
+            return wire::write_all(fd, &request, sizeof request);
+        }
+
+        bool receive(int fd, Request& request) {
+            return wire::read_all(fd, &request, sizeof request);
+        }
+
+        bool send(int fd, const Answer& answer, const Cell* cells) {
+            return wire::write_all(fd, &answer, sizeof answer)
+                && wire::write_all(fd, cells, answer.count * sizeof(Cell));
+        }
+
+        bool receive(int fd, Answer& answer, Cell* cells) {
+            return wire::read_all(fd, &answer, sizeof answer)
+                && answer.count <= max_cells
+                && wire::read_all(fd, cells, answer.count * sizeof(Cell));
+        }
+    } // namespace query
+
+    Analyst::Analyst(JohnCache* cache) {
+        add_solvers(mSched, mAdvice, cache);
+    }
+
+    int Analyst::analyze(GameData& game, query::Cell* cells) {
+        // A number that cannot be satisfied on its own would make the
+        // solvers mark past it
+        for (int iy = 1; iy <= row; iy++) {
+            for (int ix = 1; ix <= col; ix++) {
+                const Block& block = game[{ ix, iy }];
+                if (block.status == Block::number
+                    && (block.elabel < 0 || block.elabel > block.vacant_nei))
+                    throw std::runtime_error("A number cannot be satisfied");
+            }
+        }
+        std::array<bool, hash_max> was_unknown{};
+        for (int iy = 1; iy <= row; iy++) {
+            for (int ix = 1; ix <= col; ix++) {
+                const Point p{ ix, iy };
+                was_unknown[p.hash()] = game[p].status == Block::unknown;
+            }
+        }
+        // Whatever john advised on an earlier position does not apply
+        mAdvice = {};
+        mSched.solve(game);
+        int cnt = 0;
+        for (int iy = 1; iy <= row; iy++) {
+            for (int ix = 1; ix <= col; ix++) {
+                const Point p{ ix, iy };
+                if (!was_unknown[p.hash()])
+                    continue;
+                query::Cell cell{ (std::uint8_t)ix, (std::uint8_t)iy, 0, 0, 0 };
+                switch (game[p].status) {
+                    case Block::semiknown:
+                        cell.kind = query::safe;
+                        break;
+                    case Block::mine:
+                        cell.kind = query::mined;
+                        cell.chance = chance_scale;
+                        break;
+                    default:
+                        // john leaves the chance of a block off the
+                        // frontier out
+                        if (!mAdvice.chance || !on_frontier(game, p))
+                            continue;
+                        cell.kind = query::risky;
+                        cell.chance = (*mAdvice.chance)[p.hash()];
+                }
+                cells[cnt++] = cell;
+            }
+        }
+        return cnt;
+    }
+
+    void Analyst::answer(
+        const query::Request& request, std::vector<char>& out) {
+        std::array<query::Cell, query::max_cells> cells;
+        query::Answer head{ request.id, query::ok, 0, 0 };
+        if (!query::decode(request, mGame)) {
+            head.status = query::malformed;
+        } else {
+            try {
+                head.count = analyze(mGame, cells.data());
+            } catch (const std::runtime_error&) {
+                head.status = query::inconsistent;
+            }
+        }
+        const auto* h = reinterpret_cast<const char*>(&head);
+        const auto* c = reinterpret_cast<const char*>(cells.data());
+        out.insert(out.end(), h, h + sizeof head);
+        out.insert(out.end(), c, c + head.count * sizeof(query::Cell));
+    }
+
+    const Scheduler& Analyst::scheduler() const noexcept {
+        return mSched;
+    }
+
+    std::vector<query::Request> collect_positions(std::size_t count) {
+        std::vector<query::Request> positions;
+        Butterfly butt;
+        Scheduler sched;
+        Advice advice;
+        add_solvers(sched, advice);
+        std::mt19937 gen(20201);
+        while (positions.size() < count) {
+            GameData game;
+            // Layouts from gen as well, so the positions are the same on
+            // every run
+            butt.start_game({ 10, 10 }, draw_layout({ 10, 10 }, gen));
+            game.mark_semiknown({ 10, 10 });
+            accio(game, butt, true);
+            while (positions.size() < count) {
+                advice = {};
+                sched.solve(game, butt);
+                if (butt.verify())
+                    break;
+                positions.emplace_back();
+                query::encode(game, positions.back());
+                // Guess the least likely mine on the frontier, else anywhere
+                std::vector<Point> unknown;
+                Point guess{ 0, 0 };
+                for (int iy = 1; iy <= row; iy++) {
+                    for (int ix = 1; ix <= col; ix++) {
+                        const Point p{ ix, iy };
+                        if (game[p].status != Block::unknown)
+                            continue;
+                        unknown.push_back(p);
+                        if (!advice.chance || (*advice.chance)[p.hash()] == 0)
+                            continue;
+                        if (!guess.valid()
+                            || (*advice.chance)[p.hash()]
+                                < (*advice.chance)[guess.hash()])
+                            guess = p;
+                    }
+                }
+                if (!guess.valid())
+                    guess = unknown[gen() % unknown.size()];
+                game.mark_semiknown(guess);
+                if (!accio(game, butt, false))
+                    break;
+            }
+        }
+        return positions;
+    }
+} // namespace Holy
@@ -0,0 +1,128 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "scheduler.h"
+
+/// @file analysis.h Solving positions sent by other processes
+/// A client sends the board as its player sees it, and gets back the blocks
+/// the solvers prove safe or mined, and the mine chance of the rest of the
+/// frontier. solve_daemon serves these on a pool of threads.
+
+namespace Holy {
+    /// @brief The messages between solve_daemon and its clients
+    ///
+    /// A client sends Requests, the daemon answers each with an Answer
+    /// followed by Answer::count Cells, integers in native byte order.
+    /// Answers carry the id of their request and may come out of order.
+    namespace query {
+        /// @brief Board codes besides the labels 0 to 8
+        constexpr std::uint8_t unknown_code = 9, mine_code = 10;
+
+        /// @brief Bytes of a board, two blocks a byte
+        constexpr int board_bytes = (col * row + 1) / 2;
+
+        struct Request {
+            std::uint32_t id;
+            std::uint16_t mines_left;
+            std::uint16_t reserved;
+            /// Row by row, the code of block h = (y - 1) * col + x - 1 in
+            /// the low half of board[h / 2] if h is even, else the high half
+            std::uint8_t board[board_bytes];
+        };
+
+        enum Status : std::uint8_t {
+            ok = 0,
+            /// A code or mines_left is out of range
+            malformed = 1,
+            /// No layout of the mines fits the board
+            inconsistent = 2
+        };
+
+        struct Answer {
+            std::uint32_t id;
+            std::uint8_t status;
+            std::uint8_t reserved;
+            std::uint16_t count;
+        };
+
+        enum Kind : std::uint8_t {
+            /// Not decided, chance tells how likely it is a mine
+            risky = 0,
+            safe = 1,
+            mined = 2
+        };
+
+        struct Cell {
+            std::uint8_t x, y, kind, reserved;
+            /// Cases with a mine, out of chance_scale
+            std::uint32_t chance;
+        };
+
+        /// @brief Most cells in an answer
+        constexpr int max_cells = col * row;
+
+        /// @brief Writes the blocks and mines_left of game to request,
+        /// semiknown blocks as unknown
+        void encode(const GameData& game, Request& request) noexcept;
+
+        /// @brief Sets game to the board of request, with satellite data
+        /// @returns false, leaving game in an unspecified state, if the
+        /// request is malformed
+        bool decode(const Request& request, GameData& game) noexcept;
+
+        /// @returns false if fd is closed or fails
+        bool send(int fd, const Request& request);
+
+        /// @returns false if fd is closed or fails
+        bool receive(int fd, Request& request);
+
+        /// @returns false if fd is closed or fails
+        bool send(int fd, const Answer& answer, const Cell* cells);
+
+        /// @param cells -- room for max_cells cells
+        /// @returns false if fd is closed or fails, or the answer is too long
+        bool receive(int fd, Answer& answer, Cell* cells);
+    } // namespace query
+
+    /// @brief Runs the solvers on positions, without playing them
+    /// An Analyst is not thread safe, a thread should have its own.
+    class Analyst {
+    public:
+        /// @param cache -- the cache for john(), its thread's own if nullptr,
+        /// must outlive the analyst
+        explicit Analyst(JohnCache* cache = nullptr);
+
+        /// @brief Solves game as far as the solvers get without clicking,
+        /// and describes every block that was unknown and is now resolved,
+        /// or is on the frontier
+        /// @param cells -- room for query::max_cells cells
+        /// @returns the number of cells written, game holds the moves
+        /// @exception std::runtime_error if no layout of the mines fits
+        int analyze(GameData& game, query::Cell* cells);
+
+        /// @brief Answers request as solve_daemon does: decodes it,
+        /// analyzes it, and appends the Answer, with the id of request, and
+        /// its cells to out
+        /// A malformed or inconsistent board gets an answer with that
+        /// status and no cells.
+        void answer(const query::Request& request, std::vector<char>& out);
+
+        /// @returns the scheduler, for its stats
+        const Scheduler& scheduler() const noexcept;
+
+    private:
+        Scheduler mSched;
+        Advice mAdvice;
+        // The board of the request being answered
+        GameData mGame;
+    };
+
+    /// @brief Plays Butterfly games, keeping the positions a player meets
+    /// each time the solvers get stuck and a guess has to be made, until
+    /// there are count of them
+    /// Guesses take the least likely mine john() found. The ids of the
+    /// positions are 0.
+    std::vector<query::Request> collect_positions(std::size_t count);
+} // namespace Holy
+
+#endif // ANALYSIS_H
@@ -0,0 +1,55 @@
+#include "arena.h"
+
+namespace Holy {
+    Arena::Arena(std::size_t capacity) :
+        mCapacity(capacity), mBuffer(new std::byte[capacity]) {
+        mResource.emplace(mBuffer.get(), mCapacity, &mSpill);
+    }
+
+    std::pmr::memory_resource* Arena::resource() noexcept {
+        return &*mResource;
+    }
+
+    void Arena::reset() {
+        mResource->release();
+        if (mSpill.bytes == 0)
+            return;
+        // Everything of the last step fits in the buffer plus the spills
+        mResource.reset();
+        mCapacity += mSpill.bytes;
+        mSpill.bytes = 0;
+        mBuffer.reset(new std::byte[mCapacity]);
+        mResource.emplace(mBuffer.get(), mCapacity, &mSpill);
+    }
+
+    std::size_t Arena::capacity() const noexcept {
+        return mCapacity;
+    }
+
+    std::size_t Arena::spills() const noexcept {
+        return mSpill.count;
+    }
+
+    Arena& Arena::local() {
+        thread_local Arena arena;
+        return arena;
+    }
+
+    void* Arena::Spill::do_allocate(std::size_t bytes, std::size_t align) {
+        count++;
+        this->bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void Arena::Spill::do_deallocate(
+        void* p,
+        std::size_t bytes,
+        std::size_t align) {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool Arena::Spill::do_is_equal(
+        const std::pmr::memory_resource& other) const noexcept {
+        return this == &other;
+    }
+} // namespace Holy
@@ -0,0 +1,74 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+/// @file arena.h Scratch memory of the solvers
+/// A solver step builds many short-lived containers (the frontier, its
+/// components, the search kernel...). They allocate from an Arena that is
+/// reset between steps instead of from the heap, so parallel games don't
+/// contend on the allocator.
+
+namespace Holy {
+    /// @brief A monotonic arena over a buffer allocated up front
+    ///
+    /// Requests that don't fit in the buffer are still served, from the
+    /// heap, and the next reset() grows the buffer to hold them. After the
+    /// first few steps of a game the arena thus serves every step without
+    /// calling malloc.
+    class Arena {
+    public:
+        /// @brief Allocates a buffer of capacity bytes
+        explicit Arena(std::size_t capacity = 1 << 20);
+
+        // Copy operations are not permitted.
+        Arena(const Arena& src) = delete;
+
+        // Copy operations are not permitted.
+        Arena& operator=(const Arena& src) = delete;
+
+        /// @returns the resource to give to the containers of a step
+        std::pmr::memory_resource* resource() noexcept;
+
+        /// @brief Frees everything allocated since the last reset()
+        /// Containers using resource() must not be used afterwards.
+        /// @exception std::bad_alloc if the buffer has to grow
+        void reset();
+
+        /// @returns the size of the buffer in bytes
+        std::size_t capacity() const noexcept;
+
+        /// @returns the number of requests served from the heap so far
+        std::size_t spills() const noexcept;
+
+        /// @brief The arena of the calling thread
+        static Arena& local();
+
+    private:
+        // Hands requests over to the heap and keeps count of them
+        class Spill : public std::pmr::memory_resource {
+        public:
+            // Requests so far, and bytes since the last reset()
+            std::size_t count = 0, bytes = 0;
+
+        private:
+            void* do_allocate(std::size_t bytes, std::size_t align) override;
+            void do_deallocate(
+                void* p,
+                std::size_t bytes,
+                std::size_t align) override;
+            bool do_is_equal(const std::pmr::memory_resource& other)
+                const noexcept override;
+        };
+
+        std::size_t mCapacity;
+        std::unique_ptr<std::byte[]> mBuffer;
+        Spill mSpill;
+        std::optional<std::pmr::monotonic_buffer_resource> mResource;
+    };
+} // namespace Holy
+
+#endif // ARENA_H
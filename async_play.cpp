@@ -0,0 +1,280 @@
+// Contains main()
+// Plays many games on one thread with C++20 coroutines, so the solvers keep
+// working while clicks are in flight, against a mock backend that answers
+// after a given latency
+// Usage: async_play [games] [in flight] [latency in us]...
+//     games     -- games per mode and latency, 200 by default
+//     in flight -- games interleaved by the coroutine mode, 32 by default
+//     latency   -- latencies to try, 0 100 1000 5000 by default
+// For each latency, the same games are played one after another with
+// blocking clicks, then interleaved, and the games/s of both are printed.
+// This is the only target built as C++20.
+#include "generator.h"
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace Holy;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr unsigned seed = 20201;
+    constexpr Point first{ 10, 10 };
+
+    // A coroutine that starts when the loop first resumes it
+    class Task {
+    public:
+        struct promise_type {
+            std::exception_ptr error;
+
+            Task get_return_object() {
+                return Task(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+
+            std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+
+            std::suspend_always final_suspend() noexcept {
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept {
+                error = std::current_exception();
+            }
+        };
+
+        explicit Task(std::coroutine_handle<promise_type> handle) noexcept :
+            mHandle(handle) {}
+
+        Task(Task&& src) noexcept : mHandle(src.mHandle) {
+            src.mHandle = nullptr;
+        }
+
+        // Copy operations are not permitted.
+        Task(const Task& src) = delete;
+
+        // Copy operations are not permitted.
+        Task& operator=(const Task& src) = delete;
+
+        ~Task() noexcept {
+            if (mHandle)
+                mHandle.destroy();
+        }
+
+        std::coroutine_handle<> handle() const noexcept {
+            return mHandle;
+        }
+
+        // Rethrows what escaped the coroutine, if anything
+        void check() const {
+            if (mHandle.promise().error)
+                std::rethrow_exception(mHandle.promise().error);
+        }
+
+    private:
+        std::coroutine_handle<promise_type> mHandle;
+    };
+
+    // Resumes coroutines when what they wait for is ready, on the thread
+    // calling run()
+    class Loop {
+    public:
+        // Resumes h at time at
+        void wake(std::coroutine_handle<> h, Clock::time_point at) {
+            mTimers.push({ at, mSeq++, h });
+        }
+
+        // Runs until no coroutine waits
+        void run() {
+            while (!mTimers.empty()) {
+                const Timer t = mTimers.top();
+                mTimers.pop();
+                // Nothing else can run before then
+                if (t.at > Clock::now())
+                    std::this_thread::sleep_until(t.at);
+                t.h.resume();
+            }
+        }
+
+    private:
+        struct Timer {
+            Clock::time_point at;
+            // Keeps timers due at once in the order they were set
+            long long seq;
+            std::coroutine_handle<> h;
+
+            bool operator<(const Timer& rhs) const noexcept {
+                return at != rhs.at ? at > rhs.at : seq > rhs.seq;
+            }
+        };
+
+        std::priority_queue<Timer> mTimers;
+        long long mSeq = 0;
+    };
+
+    // A Butterfly whose answers to clicks take latency to arrive
+    class SlowButterfly : public Butterfly {
+    public:
+        explicit SlowButterfly(Clock::duration latency) noexcept :
+            mLatency(latency) {}
+
+        // Blocks for the latency
+        int click(const Point* batch, int n, Reveal* revealed) override {
+            std::this_thread::sleep_for(mLatency);
+            return Butterfly::click(batch, n, revealed);
+        }
+
+        // The click as an awaitable: the coroutine is suspended on loop for
+        // the latency, and gets the answer when it is resumed
+        auto click_async(
+            Loop& loop,
+            const Point* batch,
+            int n,
+            Reveal* revealed) noexcept {
+            struct Awaiter {
+                SlowButterfly& butt;
+                Loop& loop;
+                const Point* batch;
+                int n;
+                Reveal* revealed;
+
+                bool await_ready() const noexcept {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<> h) {
+                    loop.wake(h, Clock::now() + butt.mLatency);
+                }
+
+                int await_resume() {
+                    return butt.Butterfly::click(batch, n, revealed);
+                }
+            };
+            return Awaiter{ *this, loop, batch, n, revealed };
+        }
+
+    private:
+        Clock::duration mLatency;
+    };
+
+    // Starts game g of the seeded sequence on butt
+    void start(Butterfly& butt, unsigned g, GameData& game) {
+        std::seed_seq seq{ seed, g };
+        std::mt19937 rng(seq);
+        butt.start_game(first, draw_layout(first, rng));
+        game = GameData();
+        game.mark_semiknown(first);
+    }
+
+    // Plays games one after another with blocking clicks, the way
+    // deter_bench does but in rounds like the coroutines below: the solvers
+    // make every move they can, then all of them are clicked at once
+    // Returns the number of games won
+    int play_blocking(int games, Clock::duration latency) {
+        SlowButterfly butt(latency);
+        Scheduler sched;
+        Advice advice;
+        add_solvers(sched, advice);
+        int won = 0;
+        GameData game;
+        std::array<Point, col * row> batch;
+        for (int g = 0; g < games; g++) {
+            start(butt, g, game);
+            do {
+                accio(game, butt, true);
+                sched.solve(game);
+            } while (accio_batch(game, batch.data()));
+            won += butt.verify();
+        }
+        return won;
+    }
+
+    // What the coroutines of play_interleaved() share
+    struct Shared {
+        Loop loop;
+        Clock::duration latency;
+        int games, next = 0, won = 0;
+    };
+
+    // Plays games of the sequence until there are none left, suspending on
+    // every click
+    Task player(Shared& shared) {
+        SlowButterfly butt(shared.latency);
+        Scheduler sched;
+        Advice advice;
+        add_solvers(sched, advice);
+        GameData game;
+        std::array<Point, col * row> batch;
+        std::array<Reveal, col * row> revealed;
+        while (shared.next < shared.games) {
+            start(butt, shared.next++, game);
+            while (const int n = accio_batch(game, batch.data())) {
+                const int cnt = co_await butt.click_async(
+                    shared.loop, batch.data(), n, revealed.data());
+                if (cnt < 0)
+                    throw std::logic_error("A deterministic move hit a mine");
+                accio_apply(game, batch.data(), n, revealed.data(), cnt);
+                sched.solve(game);
+            }
+            shared.won += butt.verify();
+        }
+    }
+
+    // Plays the games with in_flight of them at a time on this thread
+    // Returns the number of games won
+    int play_interleaved(int games, int in_flight, Clock::duration latency) {
+        Shared shared;
+        shared.latency = latency;
+        shared.games = games;
+        std::vector<Task> players;
+        for (int i = 0; i < in_flight; i++) {
+            players.push_back(player(shared));
+            shared.loop.wake(players.back().handle(), Clock::now());
+        }
+        shared.loop.run();
+        for (const auto& p : players)
+            p.check();
+        return shared.won;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    const int games = argc > 1 ? std::atoi(argv[1]) : 200;
+    const int in_flight = argc > 2 ? std::atoi(argv[2]) : 32;
+    std::vector<long> latencies;
+    for (int i = 3; i < argc; i++)
+        latencies.push_back(std::atol(argv[i]));
+    if (latencies.empty())
+        latencies = { 0, 100, 1000, 5000 };
+    if (games <= 0 || in_flight <= 0) {
+        std::cerr << "games and in flight should be positive\n";
+        return 1;
+    }
+    std::cout << "latency(us)  blocking(games/s)  interleaved(games/s)  "
+                 "wins\n";
+    for (const long us : latencies) {
+        const auto latency = std::chrono::microseconds(us);
+        auto t0 = Clock::now();
+        const int won_blocking = play_blocking(games, latency);
+        auto t1 = Clock::now();
+        const int won_interleaved = play_interleaved(games, in_flight, latency);
+        auto t2 = Clock::now();
+        const auto rate = [&](Clock::time_point a, Clock::time_point b) {
+            return games / std::chrono::duration<double>(b - a).count();
+        };
+        std::cout << us << "  " << rate(t0, t1) << "  " << rate(t1, t2)
+                  << "  " << won_blocking << '/' << won_interleaved << '\n';
+    }
+}
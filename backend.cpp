@@ -0,0 +1,118 @@
+#include "backend.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace Holy {
+    namespace wire {
+        bool write_all(int fd, const void* buf, std::size_t size) {
+            auto* p = static_cast<const char*>(buf);
+            while (size > 0) {
+                const ssize_t done = ::write(fd, p, size);
+                if (done < 0 && errno == EINTR)
+                    continue;
+                if (done <= 0)
+                    return false;
+                p += done;
+                size -= done;
+            }
+            return true;
+        }
+
+        bool read_all(int fd, void* buf, std::size_t size) {
+            auto* p = static_cast<char*>(buf);
+            while (size > 0) {
+                const ssize_t done = ::read(fd, p, size);
+                if (done < 0 && errno == EINTR)
+                    continue;
+                if (done <= 0)
+                    return false;
+                p += done;
+                size -= done;
+            }
+            return true;
+        }
+
+        bool send(int fd, std::uint8_t code, const Cell* cells, int count) {
+            const Header header{ code, 0, (std::uint16_t)count };
+            return write_all(fd, &header, sizeof header)
+                && write_all(fd, cells, count * sizeof(Cell));
+        }
+
+        bool receive(int fd, Header& header, Cell* cells) {
+            return read_all(fd, &header, sizeof header)
+                && header.count <= max_cells
+                && read_all(fd, cells, header.count * sizeof(Cell));
+        }
+    } // namespace wire
+
+    RemoteBackend::RemoteBackend(const std::string& path) :
+        mCells(wire::max_cells) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof addr.sun_path)
+            throw std::runtime_error("Socket path too long: " + path);
+        std::strcpy(addr.sun_path, path.c_str());
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            throw std::runtime_error("Cannot create socket");
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr)
+            < 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot connect to " + path);
+        }
+        mIn = mOut = fd;
+    }
+
+    RemoteBackend::RemoteBackend(int in, int out) noexcept :
+        mIn(in), mOut(out), mCells(wire::max_cells) {}
+
+    RemoteBackend::~RemoteBackend() noexcept {
+        ::close(mIn);
+        if (mOut != mIn)
+            ::close(mOut);
+    }
+
+    wire::Status RemoteBackend::exchange(wire::Op op, int& count) const {
+        wire::Header header;
+        if (!wire::send(mOut, op, mCells.data(), count)
+            || !wire::receive(mIn, header, mCells.data()))
+            throw std::runtime_error("Lost connection to the game server");
+        mRoundTrips++;
+        if (header.code == wire::error)
+            throw std::logic_error("The game server refused the request");
+        count = header.count;
+        return (wire::Status)header.code;
+    }
+
+    void RemoteBackend::start_game(Point p) {
+        mCells[0] = { (std::uint8_t)p.x, (std::uint8_t)p.y, 0, 0 };
+        int count = 1;
+        exchange(wire::start, count);
+    }
+
+    int RemoteBackend::click(const Point* batch, int n, Reveal* revealed) {
+        for (int i = 0; i < n; i++) {
+            mCells[i] = {
+                (std::uint8_t)batch[i].x, (std::uint8_t)batch[i].y, 0, 0
+            };
+        }
+        if (exchange(wire::click, n) == wire::lost)
+            return -1;
+        for (int i = 0; i < n; i++)
+            revealed[i] = { { mCells[i].x, mCells[i].y }, mCells[i].label };
+        return n;
+    }
+
+    bool RemoteBackend::verify() const {
+        int count = 0;
+        return exchange(wire::verify, count) == wire::won;
+    }
+
+    long long RemoteBackend::round_trips() const noexcept {
+        return mRoundTrips;
+    }
+} // namespace Holy
@@ -0,0 +1,153 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include "mineutils.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @file backend.h Where the solvers get the game from
+/// accio() talks to a GameBackend: the in-process Butterfly, or a game
+/// running in another process behind RemoteBackend. Clicks go out in
+/// batches, so a round trip carries every click a solver step decided on.
+
+namespace Holy {
+    /// @brief A block exposed by a click, with its label
+    struct Reveal {
+        Point p;
+        int label;
+    };
+
+    /// @brief A minesweeper game the solvers can play
+    class GameBackend {
+    public:
+        virtual ~GameBackend() noexcept = default;
+
+        /// @brief Starts a game with a click at p
+        /// The mines are placed so that the blocks around p are clear.
+        virtual void start_game(Point p) = 0;
+
+        /// @brief Left clicks each of the n blocks at batch, in one go
+        ///
+        /// revealed receives every block the clicks show, as they would
+        /// show to a player: the clicked blocks and, from the blocks
+        /// labelled 0, their neighbors in turn. Each block appears once.
+        /// @param revealed -- room for col * row entries
+        /// @returns the number of entries written to revealed,
+        /// or -1 if a clicked block is a mine, which ends the game
+        /// @exception std::logic_error if no game has started
+        virtual int click(const Point* batch, int n, Reveal* revealed) = 0;
+
+        /// @brief Tells whether every block without a mine has been exposed
+        /// @exception std::logic_error if no game has started
+        virtual bool verify() const = 0;
+    };
+
+    /// @brief The messages between a RemoteBackend and a game server
+    ///
+    /// A message is a Header followed by Header::count Cells, integers in
+    /// native byte order. The client sends an Op with the blocks it
+    /// applies to, the server answers with a Status and, for click, the
+    /// blocks revealed.
+    namespace wire {
+        enum Op : std::uint8_t {
+            /// Start a game, one cell: the first click
+            start = 1,
+            /// Click the cells
+            click = 2,
+            /// Ask whether the game is won, no cells
+            verify = 3
+        };
+
+        enum Status : std::uint8_t {
+            ok = 0,
+            /// A clicked cell was a mine
+            lost = 1,
+            /// Answer to verify when the game is won
+            won = 2,
+            /// The request was malformed or came before start
+            error = 3
+        };
+
+        struct Header {
+            std::uint8_t code;
+            std::uint8_t reserved;
+            std::uint16_t count;
+        };
+
+        struct Cell {
+            std::uint8_t x, y, label, reserved;
+        };
+
+        /// @brief Most cells in a message
+        constexpr int max_cells = col * row;
+
+        /// @brief Writes size bytes at buf to fd, retrying on partial
+        /// writes and signals
+        /// @returns false if fd is closed or fails
+        bool write_all(int fd, const void* buf, std::size_t size);
+
+        /// @brief Reads size bytes from fd to buf, retrying like write_all()
+        /// @returns false on end of file or errors
+        bool read_all(int fd, void* buf, std::size_t size);
+
+        /// @brief Writes a message of count cells to fd
+        /// @returns false if fd is closed or fails
+        bool send(int fd, std::uint8_t code, const Cell* cells, int count);
+
+        /// @brief Reads a message from fd
+        /// @param cells -- room for max_cells cells
+        /// @returns false if fd is closed or fails, or the message is too
+        /// long
+        bool receive(int fd, Header& header, Cell* cells);
+    } // namespace wire
+
+    /// @brief A game played by a server in another process
+    class RemoteBackend : public GameBackend {
+    public:
+        /// @brief Connects to the server listening on the Unix domain
+        /// socket at path
+        /// @exception std::runtime_error if the connection fails
+        explicit RemoteBackend(const std::string& path);
+
+        /// @brief Talks to a server by reading in and writing out, such as
+        /// the ends of two pipes, which are closed on destruction
+        RemoteBackend(int in, int out) noexcept;
+
+        // Copy operations are not permitted.
+        RemoteBackend(const RemoteBackend& src) = delete;
+
+        // Copy operations are not permitted.
+        RemoteBackend& operator=(const RemoteBackend& src) = delete;
+
+        // Closes the connection
+        ~RemoteBackend() noexcept override;
+
+        /// @exception std::runtime_error on I/O errors,
+        /// std::logic_error if the server refuses the request
+        void start_game(Point p) override;
+
+        /// @exception std::runtime_error as start_game()
+        int click(const Point* batch, int n, Reveal* revealed) override;
+
+        /// @exception std::runtime_error as start_game()
+        bool verify() const override;
+
+        /// @returns the number of requests answered so far
+        long long round_trips() const noexcept;
+
+    private:
+        // Sends a request of the first count cells of mCells and reads the
+        // answer into mCells, setting count to its number of cells
+        // Returns the status of the answer
+        wire::Status exchange(wire::Op op, int& count) const;
+
+        int mIn = -1, mOut = -1;
+        // Cells of the last message, both ways, max_cells of them
+        mutable std::vector<wire::Cell> mCells;
+        mutable long long mRoundTrips = 0;
+    };
+} // namespace Holy
+
+#endif // BACKEND_H
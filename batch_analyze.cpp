@@ -0,0 +1,235 @@
+// Contains main()
+// Analyzes a file of positions on a pool of threads
+// Usage: batch_analyze <positions> <answers> [threads]
+//        batch_analyze collect <positions> [count]
+//     positions -- query::Request records one after another, as sent to
+//                  solve_daemon
+//     answers   -- gets an answer per position, as solve_daemon sends it:
+//                  a query::Answer then its query::Cells, in the order of
+//                  the positions
+//     threads   -- one per hardware thread by default
+//     count     -- positions collect writes, from Butterfly games as in
+//                  collect_positions(), 1000 by default
+// The main thread reads the positions a chunk at a time, keeping a window
+// of chunks ahead of the one it writes, and the threads take the chunks in
+// turn, each with its own Analyst and john cache.
+#include "analysis.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace Holy;
+
+namespace {
+    // Positions a thread takes at a time
+    constexpr int chunk_size = 16;
+
+    // Chunks read ahead of the one being written, per thread
+    constexpr int window_per_thread = 8;
+
+    struct Chunk {
+        std::vector<query::Request> in;
+        // The answers, and how many of them have each query::Status
+        std::vector<char> out;
+        long long status[3] = {};
+        bool done = false;
+    };
+
+    // The chunks between reading and writing, in the order of the input
+    class Window {
+    public:
+        // Adds a chunk to be analyzed
+        void push(std::unique_ptr<Chunk> chunk) {
+            {
+                std::lock_guard lock(mMutex);
+                mChunks.push_back(std::move(chunk));
+            }
+            mChanged.notify_all();
+        }
+
+        // No more chunks are coming
+        void close() {
+            {
+                std::lock_guard lock(mMutex);
+                mClosed = true;
+            }
+            mChanged.notify_all();
+        }
+
+        std::size_t size() {
+            std::lock_guard lock(mMutex);
+            return mChunks.size();
+        }
+
+        // Returns the first chunk no thread has taken, waiting for one, or
+        // nullptr once the window is closed and all have been taken
+        Chunk* take() {
+            std::unique_lock lock(mMutex);
+            mChanged.wait(
+                lock, [this] { return mNext < mChunks.size() || mClosed; });
+            if (mNext == mChunks.size())
+                return nullptr;
+            return mChunks[mNext++].get();
+        }
+
+        // Marks a chunk taken by take() as analyzed
+        void finish(Chunk* chunk) {
+            {
+                std::lock_guard lock(mMutex);
+                chunk->done = true;
+            }
+            mChanged.notify_all();
+        }
+
+        // Removes the first chunk once it is analyzed, waiting for it, or
+        // returns nullptr if the window is closed and empty
+        std::unique_ptr<Chunk> pop() {
+            std::unique_lock lock(mMutex);
+            mChanged.wait(lock, [this] {
+                return (!mChunks.empty() && mChunks.front()->done)
+                    || (mChunks.empty() && mClosed);
+            });
+            if (mChunks.empty())
+                return nullptr;
+            auto ret = std::move(mChunks.front());
+            mChunks.pop_front();
+            mNext--;
+            return ret;
+        }
+
+    private:
+        std::mutex mMutex;
+        std::condition_variable mChanged;
+        std::deque<std::unique_ptr<Chunk>> mChunks;
+        // Index in mChunks of the first chunk not taken
+        std::size_t mNext = 0;
+        bool mClosed = false;
+    };
+
+    // Body of an analyzing thread
+    void worker(Window& window) {
+        Analyst analyst;
+        while (Chunk* chunk = window.take()) {
+            for (const auto& request : chunk->in) {
+                const std::size_t at = chunk->out.size();
+                analyst.answer(request, chunk->out);
+                query::Answer head;
+                std::copy(chunk->out.begin() + at,
+                    chunk->out.begin() + at + sizeof head,
+                    reinterpret_cast<char*>(&head));
+                chunk->status[head.status]++;
+            }
+            window.finish(chunk);
+        }
+    }
+
+    // Reads the next chunk of in, or returns nullptr at its end
+    std::unique_ptr<Chunk> read_chunk(std::istream& in) {
+        auto chunk = std::make_unique<Chunk>();
+        chunk->in.resize(chunk_size);
+        in.read(reinterpret_cast<char*>(chunk->in.data()),
+            chunk_size * sizeof(query::Request));
+        const std::size_t got = in.gcount();
+        if (got % sizeof(query::Request))
+            throw std::runtime_error("The last position is cut short");
+        chunk->in.resize(got / sizeof(query::Request));
+        if (chunk->in.empty())
+            return nullptr;
+        return chunk;
+    }
+
+    int collect(const char* path, long long count) {
+        auto positions = collect_positions(count);
+        for (std::size_t i = 0; i < positions.size(); i++)
+            positions[i].id = i;
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(positions.data()),
+            positions.size() * sizeof(query::Request));
+        if (!out) {
+            std::cerr << "Cannot write " << path << '\n';
+            return 1;
+        }
+        std::cout << "Positions: " << positions.size() << '\n';
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::string(argv[1]) == "collect") {
+        if (argc < 3) {
+            std::cerr << "Usage: batch_analyze collect <positions> [count]\n";
+            return 1;
+        }
+        return collect(argv[2], argc > 3 ? std::atoll(argv[3]) : 1000);
+    }
+    if (argc < 3) {
+        std::cerr << "Usage: batch_analyze <positions> <answers> [threads]\n";
+        return 1;
+    }
+    const int threads = argc > 3
+        ? std::atoi(argv[3])
+        : (int)std::max(1u, std::thread::hardware_concurrency());
+    if (threads < 1) {
+        std::cerr << "threads should be positive\n";
+        return 1;
+    }
+    std::ifstream in(argv[1], std::ios::binary);
+    std::ofstream out(argv[2], std::ios::binary);
+    if (!in || !out) {
+        std::cerr << "Cannot open " << (in ? argv[2] : argv[1]) << '\n';
+        return 1;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    Window window;
+    std::vector<std::thread> pool;
+    for (int t = 0; t < threads; t++)
+        pool.emplace_back(worker, std::ref(window));
+    long long positions = 0, status[3] = {};
+    int exit = 0;
+    try {
+        const std::size_t ahead = std::size_t(window_per_thread) * threads;
+        bool more = true;
+        while (true) {
+            while (more && window.size() < ahead) {
+                if (auto chunk = read_chunk(in))
+                    window.push(std::move(chunk));
+                else
+                    more = false;
+            }
+            if (!more)
+                window.close();
+            const auto chunk = window.pop();
+            if (!chunk)
+                break;
+            out.write(chunk->out.data(), chunk->out.size());
+            positions += chunk->in.size();
+            for (int s = 0; s < 3; s++)
+                status[s] += chunk->status[s];
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        window.close();
+        exit = 1;
+    }
+    for (auto& t : pool)
+        t.join();
+    if (!out.flush()) {
+        std::cerr << "Cannot write " << argv[2] << '\n';
+        return 1;
+    }
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Positions: " << positions << " in " << seconds << "s on "
+              << threads << " threads, " << positions / seconds
+              << " positions/s\n";
+    std::cout << "Answers ok: " << status[query::ok]
+              << "    malformed: " << status[query::malformed]
+              << "    inconsistent: " << status[query::inconsistent] << '\n';
+    return exit;
+}
@@ -0,0 +1,47 @@
+// Contains main()
+// Writes boards that can be won from the first click without guessing
+// Usage: board_gen <file> [count] [threads] [repairs]
+//     count   -- boards to write, 1000 by default
+//     threads -- one per hardware thread by default
+//     repairs -- repairs of a board before it is drawn again, 4 by
+//                default, 0 to draw every board from scratch
+#include "generator.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Holy;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: board_gen <file> [count] [threads] [repairs]\n";
+        return 1;
+    }
+    const long long count = argc > 2 ? std::atoll(argv[2]) : 1000;
+    GeneratorConfig config;
+    if (argc > 3)
+        config.threads = std::atoi(argv[3]);
+    if (argc > 4)
+        config.repairs = std::atoi(argv[4]);
+    if (count < 0 || config.repairs < 0) {
+        std::cerr << "count and repairs should not be negative\n";
+        return 1;
+    }
+    GeneratorStats stats;
+    const auto start = std::chrono::steady_clock::now();
+    const auto boards = generate_boards(count, config, &stats);
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    try {
+        write_boards(argv[1], config.first, boards);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    std::cout << "Boards: " << stats.kept << " in " << seconds << "s, "
+              << stats.kept / seconds << " boards/s\n";
+    std::cout << "Drawn: " << stats.drawn << "    repairs: " << stats.repairs
+              << " moving " << stats.moved << " mines    kept after repair: "
+              << stats.kept_repaired << '\n';
+}
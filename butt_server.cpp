@@ -0,0 +1,105 @@
+// Contains main()
+// Stand-in for the game process: serves Butterfly games to RemoteBackend
+// Usage: butt_server <socket>   serves clients one at a time on a Unix
+//                               domain socket
+//        butt_server -          serves one client on stdin and stdout
+#include "butterfly.h"
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace Holy;
+
+// Handles one request, the answer is written back to header and cells
+void handle(Butterfly& butt, wire::Header& header, wire::Cell* cells) {
+    const int n = header.count;
+    std::array<Point, wire::max_cells> batch;
+    for (int i = 0; i < n; i++) {
+        batch[i] = { cells[i].x, cells[i].y };
+        if (!batch[i].valid()) {
+            header = { wire::error, 0, 0 };
+            return;
+        }
+    }
+    try {
+        switch (header.code) {
+            case wire::start:
+                if (n != 1)
+                    break;
+                butt.start_game(batch[0]);
+                header = { wire::ok, 0, 0 };
+                return;
+            case wire::click: {
+                std::array<Reveal, col * row> revealed;
+                const int cnt = butt.click(batch.data(), n, revealed.data());
+                if (cnt < 0) {
+                    header = { wire::lost, 0, 0 };
+                    return;
+                }
+                for (int i = 0; i < cnt; i++) {
+                    const auto& r = revealed[i];
+                    cells[i] = { (std::uint8_t)r.p.x, (std::uint8_t)r.p.y,
+                        (std::uint8_t)r.label, 0 };
+                }
+                header = { wire::ok, 0, (std::uint16_t)cnt };
+                return;
+            }
+            case wire::verify:
+                header = { butt.verify() ? wire::won : wire::ok, 0, 0 };
+                return;
+        }
+    } catch (const std::logic_error&) {
+        // Clicked before the game started
+    }
+    header = { wire::error, 0, 0 };
+}
+
+// Serves requests until the client goes away
+void serve(int in, int out) {
+    Butterfly butt;
+    wire::Header header;
+    std::array<wire::Cell, wire::max_cells> cells;
+    while (wire::receive(in, header, cells.data())) {
+        handle(butt, header, cells.data());
+        if (!wire::send(out, header.code, cells.data(), header.count))
+            return;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: butt_server <socket> | butt_server -\n";
+        return 1;
+    }
+    // A client going away shows up as a failed write instead
+    std::signal(SIGPIPE, SIG_IGN);
+    if (std::strcmp(argv[1], "-") == 0) {
+        serve(STDIN_FILENO, STDOUT_FILENO);
+        return 0;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(argv[1]) >= sizeof addr.sun_path) {
+        std::cerr << "Socket path too long\n";
+        return 1;
+    }
+    std::strcpy(addr.sun_path, argv[1]);
+    ::unlink(argv[1]);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0
+        || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0
+        || ::listen(fd, 8) < 0) {
+        std::cerr << "Cannot listen on " << argv[1] << '\n';
+        return 1;
+    }
+    while (true) {
+        const int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0)
+            continue;
+        serve(client, client);
+        ::close(client);
+    }
+}
@@ -1,9 +1,8 @@
 #include "butterfly.h"
+#include "trace.h"
 #include <algorithm>
 #include <chrono>
-#include <queue>
 #include <random>
-#include <vector>
 
 namespace Holy {
     Butterfly::Butterfly() :
@@ -12,15 +11,9 @@ namespace Holy {
     }
 
     void Butterfly::start_game(Point p) {
-        mInGame = true;
-        for (auto& row : mMined)
-            row = 0;
-        for (auto& row : mExpose)
-            row = 0;
-        for (auto& row : mLabel)
-            row.fill(0);
-        std::vector<Point> possible;
-        possible.reserve(col * row - 4);
+        // At most col * row - 4 blocks, the first cnt of possible
+        std::array<Point, col * row> possible;
+        int cnt = 0;
         const auto adjacent = [p](Point np) {
             return -1 <= p.x - np.x and p.x - np.x <= 1 and -1 <= p.y - np.y
                 and p.y - np.y <= 1;
@@ -28,27 +21,94 @@ namespace Holy {
         for (int ix = 1; ix <= col; ix++) {
             for (int iy = 1; iy <= row; iy++) {
                 if (not adjacent({ ix, iy }))
-                    possible.push_back({ ix, iy });
+                    possible[cnt++] = { ix, iy };
             }
         }
         using std::chrono::system_clock;
-        std::shuffle(std::begin(possible), std::end(possible), mGen);
-        for (int i = 1; i <= mines; i++) {
-            Point& p = possible[i];
-            mMined[p.x][p.y] = true;
+        std::shuffle(possible.begin(), possible.begin() + cnt, mGen);
+        Checklist mined;
+        for (int i = 1; i <= mines; i++)
+            mined[possible[i].hash()] = true;
+        start_game(p, mined);
+    }
+
+    void Butterfly::start_game(Point p, const Checklist& mined) {
+        if (!p.valid() || mined.count() != mines)
+            throw std::invalid_argument("Not a layout of the board");
+        bool clear = true;
+        p.for_each_nei8([&](Point np) {
+            clear = clear && !mined[np.hash()];
+        });
+        if (mined[p.hash()] || !clear)
+            throw std::invalid_argument("The first click is next to a mine");
+        mInGame = true;
+        for (auto& row : mMined)
+            row = 0;
+        for (auto& row : mExpose)
+            row = 0;
+        for (auto& row : mLabel)
+            row.fill(0);
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                if (mined[Point{ ix, iy }.hash()])
+                    mMined[ix][iy] = true;
+            }
         }
         // Now accumulate the labels
-        for (int i = 1; i <= mines; i++) {
-            Point& p = possible[i];
-            p.for_each_nei8([this](Point np) {
-                if (not mMined[np.x][np.y])
-                    mLabel[np.x][np.y]++;
-            });
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                if (!mMined[ix][iy])
+                    continue;
+                Point{ ix, iy }.for_each_nei8([this](Point np) {
+                    if (not mMined[np.x][np.y])
+                        mLabel[np.x][np.y]++;
+                });
+            }
         }
+        mMetrics.reset();
+        if (mMeasure)
+            mMetrics = measure_board();
         // Do the first click
         click(p);
     }
 
+    BoardMetrics Butterfly::measure_board() const {
+        BoardMetrics ret;
+        // The last opening to show a block, 0 if none has
+        std::array<std::array<int, row + 1>, col + 1> shown{};
+        std::array<Point, col * row> q;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                if (mMined[ix][iy] || mLabel[ix][iy] != 0 || shown[ix][iy])
+                    continue;
+                // A 0 no opening has shown starts one, flooded as in
+                // expose(): the neighbors of a 0 are never mines
+                const int id = ++ret.openings;
+                int head = 0, tail = 0, blocks = 1;
+                q[tail++] = { ix, iy };
+                shown[ix][iy] = id;
+                while (head < tail) {
+                    q[head++].for_each_nei8([&](Point np) {
+                        if (shown[np.x][np.y] == id)
+                            return;
+                        shown[np.x][np.y] = id;
+                        blocks++;
+                        if (mLabel[np.x][np.y] == 0)
+                            q[tail++] = np;
+                    });
+                }
+                ret.opening_blocks += blocks;
+                ret.largest_opening = std::max(ret.largest_opening, blocks);
+            }
+        }
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++)
+                ret.isolated += !mMined[ix][iy] && !shown[ix][iy];
+        }
+        ret.bbbv = ret.openings + ret.isolated;
+        return ret;
+    }
+
     std::optional<int> Butterfly::read(Point p) const {
         if (not mInGame)
             throw std::logic_error("Has not started game!");
@@ -58,35 +118,63 @@ namespace Holy {
     }
 
     std::optional<int> Butterfly::click(Point p) {
+        const trace::Span span("Butterfly::click");
         if (!mInGame)
             throw std::logic_error("Has not started game!");
         if (mMined[p.x][p.y]) {
             mInGame = false;
             return std::nullopt;
         }
+        Checklist seen = 0;
+        int cnt = 0;
+        expose(p, seen, nullptr, cnt);
+        return std::make_optional(mLabel[p.x][p.y]);
+    }
+
+    int Butterfly::click(const Point* batch, int n, Reveal* revealed) {
+        const trace::Span span("Butterfly::click");
+        if (!mInGame)
+            throw std::logic_error("Has not started game!");
+        for (int i = 0; i < n; i++) {
+            if (mMined[batch[i].x][batch[i].y]) {
+                mInGame = false;
+                return -1;
+            }
+        }
+        Checklist seen = 0;
+        int cnt = 0;
+        for (int i = 0; i < n; i++)
+            expose(batch[i], seen, revealed, cnt);
+        return cnt;
+    }
+
+    void Butterfly::expose(Point p, Checklist& seen, Reveal* out, int& cnt) {
+        // A block already seen has had its neighbors handled, if it is a 0
+        if (seen[p.hash()])
+            return;
         // If this is not mined, then push it into a queue for processing
         // This is the BFS manner of doing things.
-        std::queue<Point> q;
-        // vis to eliminate double-checks
-        Checklist vis = 0;
-        q.push(p);
-        vis[p.hash()] = true;
-        while (!q.empty()) {
+        // Every block is pushed at most once, so the queue fits in q
+        std::array<Point, col * row> q;
+        int head = 0, tail = 0;
+        q[tail++] = p;
+        seen[p.hash()] = true;
+        while (head < tail) {
             // Every point in q is not a mine, but possibly 0
-            // and vis[p] is true
-            Point p = q.front();
-            q.pop();
+            // and seen[p] is true
+            Point p = q[head++];
             // Now p is shielded by local variable
             mExpose[p.x][p.y] = true;
+            if (out)
+                out[cnt++] = { p, mLabel[p.x][p.y] };
             if (mLabel[p.x][p.y] == 0)
                 p.for_each_nei8([&, this](Point np) {
-                    if (!mMined[np.x][np.y] && !vis[np.hash()]) {
-                        q.push(np);
-                        vis[np.hash()] = true;
+                    if (!mMined[np.x][np.y] && !seen[np.hash()]) {
+                        q[tail++] = np;
+                        seen[np.hash()] = true;
                     }
                 });
         }
-        return std::make_optional(mLabel[p.x][p.y]);
     }
 
     bool Butterfly::verify() const {
@@ -102,4 +190,27 @@ namespace Holy {
     bool Butterfly::in_game() const noexcept {
         return mInGame;
     }
+
+    void Butterfly::measure(bool on) noexcept {
+        mMeasure = on;
+    }
+
+    const std::optional<BoardMetrics>& Butterfly::metrics() const noexcept {
+        return mMetrics;
+    }
+
+    int bbbv_bucket(const BoardMetrics& metrics) noexcept {
+        return std::upper_bound(
+                   bbbv_bounds.begin(), bbbv_bounds.end(), metrics.bbbv)
+            - bbbv_bounds.begin();
+    }
+
+    std::string bbbv_range(int bucket) {
+        if (bucket == 0)
+            return "<" + std::to_string(bbbv_bounds[0]);
+        if (bucket == (int)bbbv_bounds.size())
+            return std::to_string(bbbv_bounds.back()) + "+";
+        return std::to_string(bbbv_bounds[bucket - 1]) + "-"
+            + std::to_string(bbbv_bounds[bucket] - 1);
+    }
 } // namespace Holy
\ No newline at end of file
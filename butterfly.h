@@ -1,14 +1,43 @@
 #ifndef BUTTERFLY_H
 #define BUTTERFLY_H
 
+#include "backend.h"
 #include "mineutils.h"
 #include <bitset>
 #include <optional>
 #include <random>
+#include <string>
 
 namespace Holy {
+    // How hard a board is, the way minesweeper players measure it
+    struct BoardMetrics {
+        // Least left clicks that clear the board: a click per opening and
+        // per isolated number
+        int bbbv = 0;
+        // Regions of connected 0s, which a single click shows together with
+        // the numbers around them
+        int openings = 0;
+        // Blocks the openings show, a number on the edge of two counted in
+        // both, and the most one of them shows
+        int opening_blocks = 0, largest_opening = 0;
+        // Numbers next to no 0, which only a click of their own shows
+        int isolated = 0;
+    };
+
+    // Bounds of 3BV that split boards into buckets for benchmarks: bucket i
+    // has bbbv_bounds[i - 1] <= 3BV < bbbv_bounds[i]. Boards drawn from
+    // (10, 10) have a median 3BV near 170, and a quarter of them are below
+    // 158 and above 183.
+    constexpr std::array<int, 3> bbbv_bounds = { 150, 170, 190 };
+
+    // Returns the bucket of a board, 0 to bbbv_bounds.size()
+    int bbbv_bucket(const BoardMetrics& metrics) noexcept;
+
+    // Returns the range of 3BV of a bucket, as "150-169" or "190+"
+    std::string bbbv_range(int bucket);
+
     // This class serves as a mock-minesweeper program
-    class Butterfly {
+    class Butterfly : public GameBackend {
     public:
         // Initializes Butterfly, especially the gen engine
         Butterfly();
@@ -28,12 +57,18 @@ namespace Holy {
         Butterfly(Butterfly&& src) noexcept = default;
 
         // Default virtual destructor
-        virtual ~Butterfly() noexcept = default;
+        ~Butterfly() noexcept override = default;
 
         // starts a game with click at p(x, y)
         // Plot mines so that (x-1, y-1) to (x+1, y+1) are cleared
         // Will spend some time plotting the game
-        void start_game(Point p);
+        void start_game(Point p) override;
+
+        // Starts a game on the given layout, with click at p
+        // mined holds the mines by Point::hash(), there should be exactly
+        // `mines` of them and none in (x-1, y-1) to (x+1, y+1),
+        // otherwise throws std::invalid_argument
+        void start_game(Point p, const Checklist& mined);
 
         // Reads from a block, to simulate real minesweeper games, tells the
         // difference from empty and 0 by returning as optional
@@ -52,17 +87,28 @@ namespace Holy {
         // If probes a number, returns the label, which may be 0
         std::optional<int> click(Point p);
 
+        // Clicks a batch of points, see GameBackend::click()
+        int click(const Point* batch, int n, Reveal* revealed) override;
+
         // Verifies that you have won the game
         // Returns true only if you have probed all blocks with a label of
         // [0,8], which consequently leaves blocks with mine empty
         // Otherwise, returns false Throws std::logic_error if start_game has not been
         // called
-        bool verify() const;
+        bool verify() const override;
 
         // Tells you whether currently in a game.
         // Returns the value as dictated in mInGame
         bool in_game() const noexcept;
 
+        // Whether start_game measures the boards it starts, off by default
+        // It costs a pass over the labels, a small part of start_game
+        void measure(bool on) noexcept;
+
+        // Returns the metrics of the current board, which are empty unless
+        // it was started with measure on
+        const std::optional<BoardMetrics>& metrics() const noexcept;
+
     private:
         // Invariant: verify() that returns true sets this to false
         // clicking a mine causes end of game
@@ -85,6 +131,17 @@ namespace Holy {
 
         // The random generator to be used
         std::mt19937 mGen;
+
+        // invariant: set in start_game if mMeasure, empty otherwise
+        bool mMeasure = false;
+        std::optional<BoardMetrics> mMetrics;
+
+        // Measures the board from mMined and mLabel
+        BoardMetrics measure_board() const;
+
+        // Exposes the blocks a click at p shows, p must not be a mine
+        // Blocks not in seen are written to out and added to seen
+        void expose(Point p, Checklist& seen, Reveal* out, int& cnt);
     };
 } // namespace Holy
 
@@ -1,7 +1,13 @@
-#include "solvers.h"
+#include "generator.h"
+#include "running.h"
+#include "scheduler.h"
+#include "trace.h"
 #include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 
 using namespace Holy;
 
@@ -17,82 +23,218 @@ long long trivial_total;
 // Total time on john, in ms
 long long john_total;
 
-void main_loop(Butterfly& butt) {
+// Every game is played by an adaptive and a fixed order scheduler on the
+// same layout, so the time the adaptive one saves is measured game by game.
+// The layout of game g is drawn from the seed sequence (layout_seed, g).
+constexpr unsigned layout_seed = 20201;
+long long game_index;
+Advice advice;
+Scheduler adaptive_sched(Scheduler::Policy::adaptive),
+    fixed_sched(Scheduler::Policy::fixed);
+
+// Time of the games of each scheduler, in ns, in total and outside john,
+// whose long searches make the total noisy
+struct GameTime {
+    long long total = 0, no_john = 0;
+} adaptive_time, fixed_time;
+
+// Wins of the fixed order scheduler
+int fixed_won;
+
+// Time the adaptive scheduler saves over the fixed one per game, in us, in
+// total and outside john
+Running saved, saved_no_john;
+
+// The server played against if HOLY_BACKEND names its socket, and its
+// round trips when the current 100 games started
+std::unique_ptr<RemoteBackend> remote;
+long long trips_base;
+
+// Stats of adaptive_sched when the current 100 games started
+std::vector<Scheduler::Stats> stats_base;
+Scheduler::Stats accio_base;
+
+// Hardware counters of the main thread if HOLY_PERF is set, counted by
+// adaptive_sched
+std::unique_ptr<perf::Counters> counters;
+
+// Index of john in both schedulers
+int john_stage;
+
+// Plays a game with sched on the layout mined, or on a layout of the
+// server's choosing if there is one, as the protocol cannot pick it: paired
+// games then only share the kind of board. Adds the time of the game to
+// time and returns whether it is won.
+bool play(Butterfly& local, Scheduler& sched, const Checklist& mined,
+    GameTime& time) {
+    using namespace std::chrono;
+    GameBackend& butt = remote ? (GameBackend&)*remote : local;
+    const long long john_ns = sched.stats(john_stage).nanoseconds;
+    const auto start = steady_clock::now();
     GameData game;
-    butt.start_game({ 10, 10 });
+    if (remote)
+        remote->start_game({ 10, 10 });
+    else
+        local.start_game({ 10, 10 }, mined);
     game.mark_semiknown({ 10, 10 });
     accio(game, butt, true);
-    bool has_hope;
-    bool first = true;
-    int roundup_cnt = 0, felix_cnt = 0;
-    using namespace std::chrono;
-trivial_start:
-    auto start = high_resolution_clock::now();
-    do {
-        has_hope = false;
-        while (++roundup_cnt && roundup(game)) {
-            has_hope = true;
-            accio(game, butt, true);
-        }
-        while (++felix_cnt && felix(game)) {
-            has_hope = true;
-            accio(game, butt, true);
-        }
-    } while (has_hope);
-    auto end = high_resolution_clock::now();
-    trivial_total += duration_cast<milliseconds>(end - start).count();
-    if (butt.verify()) {
-        won++;
-        if (first)
-            john_uninvoked++;
-        return;
-    }
-    if (first)
-        john_invoked++;
-    start = high_resolution_clock::now();
-    auto [guess, mc] = john(game);
-    if (!mc) {
-        // Deterministic
-        accio(game, butt, true);
-        john_det++;
-        end = high_resolution_clock::now();
-        john_total += duration_cast<milliseconds>(end - start).count();
-        first = false;
-        goto trivial_start;
-    }
-    end = high_resolution_clock::now();
-    john_total += duration_cast<milliseconds>(end - start).count();
-    if (butt.verify())
+    sched.solve(game, butt);
+    const long long ns =
+        duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    time.total += ns;
+    time.no_john += ns - (sched.stats(john_stage).nanoseconds - john_ns);
+    return butt.verify();
+}
+
+void main_loop(Butterfly& local) {
+    std::seed_seq seq{ layout_seed, (unsigned)game_index };
+    std::mt19937 rng(seq);
+    const Checklist mined = draw_layout({ 10, 10 }, rng);
+    // Each scheduler goes first in every other game, so neither always
+    // finds the caches warmed by the other
+    const bool fixed_first = game_index++ % 2;
+    GameTime adaptive_game, fixed_game;
+    bool fixed_result = false;
+    if (fixed_first)
+        fixed_result = play(local, fixed_sched, mined, fixed_game);
+    const long long john_runs = adaptive_sched.stats(john_stage).runs;
+    const long long john_fired = adaptive_sched.stats(john_stage).fired;
+    if (play(local, adaptive_sched, mined, adaptive_game))
         won++;
     else
         lost++;
+    if (adaptive_sched.stats(john_stage).runs > john_runs)
+        john_invoked++;
+    else
+        john_uninvoked++;
+    john_det += adaptive_sched.stats(john_stage).fired - john_fired;
+    if (!fixed_first)
+        fixed_result = play(local, fixed_sched, mined, fixed_game);
+    fixed_won += fixed_result;
+    adaptive_time.total += adaptive_game.total;
+    adaptive_time.no_john += adaptive_game.no_john;
+    fixed_time.total += fixed_game.total;
+    fixed_time.no_john += fixed_game.no_john;
+    saved.add((fixed_game.total - adaptive_game.total) / 1000.0);
+    saved_no_john.add((fixed_game.no_john - adaptive_game.no_john) / 1000.0);
 }
 
 void reset_global() {
     john_det = john_invoked = john_uninvoked = 0;
     won = lost = 0;
     trivial_total = john_total = 0;
+    adaptive_time = fixed_time = {};
+    fixed_won = 0;
+    saved = saved_no_john = {};
+    trips_base = remote ? remote->round_trips() : 0;
+    stats_base.clear();
+    for (int i = 0; i < adaptive_sched.size(); i++)
+        stats_base.push_back(adaptive_sched.stats(i));
+    accio_base = adaptive_sched.accio_stats();
+}
+
+// Writes IPC and events per call of a phase, given its stats now and when
+// the current 100 games started
+void write_events(std::ostream& file, const std::string& name,
+    const Scheduler::Stats& now, const Scheduler::Stats& base) {
+    using namespace perf;
+    const Sample events = now.events - base.events;
+    const long long calls = std::max(now.runs - base.runs, 1LL);
+    file << "    " << name << ": IPC ";
+    if (counters->available(cycles) && counters->available(instructions)
+        && events.count[cycles] > 0)
+        file << (double)events.count[instructions] / events.count[cycles];
+    else
+        file << "n/a";
+    for (auto e : { cycles, l1d_misses, llc_misses, branch_misses }) {
+        file << "    " << perf::name(e) << "/call ";
+        if (counters->available(e))
+            file << events.count[e] / calls;
+        else
+            file << "n/a";
+    }
+    file << '\n';
 }
 
 void write_data(std::ostream& file) {
+    // Time of each stage in these games
+    std::vector<long long> stage_ms;
+    for (int i = 0; i < adaptive_sched.size(); i++) {
+        stage_ms.push_back(
+            (adaptive_sched.stats(i).nanoseconds - stats_base[i].nanoseconds)
+            / 1000000);
+    }
+    for (int i = 0; i < adaptive_sched.size(); i++)
+        (i == john_stage ? john_total : trivial_total) += stage_ms[i];
+    const int games = won + lost;
     file << "Won: " << won << "    lost: " << lost << '\n';
     file << "John invoked: " << john_invoked << "    not: " << john_uninvoked
          << '\n';
     file << "John determined: " << john_det << '\n';
     file << "Total time on john: " << john_total << "ms\n";
-    file << "Total time on trivial: " << trivial_total << "ms\n\n";
+    file << "Total time on trivial: " << trivial_total << "ms\n";
+    for (int i = 0; i < adaptive_sched.size(); i++) {
+        const auto& st = adaptive_sched.stats(i);
+        file << "    " << adaptive_sched.stage(i).name
+             << ": runs " << st.runs - stats_base[i].runs << "    fired "
+             << st.fired - stats_base[i].fired << "    skipped "
+             << st.skipped - stats_base[i].skipped << "    " << stage_ms[i]
+             << "ms\n";
+    }
+    file << "Time per game, adaptive: " << adaptive_time.total / games / 1000
+         << "us    fixed order: " << fixed_time.total / games / 1000
+         << "us (won " << fixed_won << ")\n";
+    write_interval(file, "Saved by the scheduler per game: ", saved);
+    write_interval(file, "us    outside john: ", saved_no_john);
+    file << "us\n";
+    if (counters && counters->any()) {
+        file << "Hardware events of the adaptive scheduler:\n";
+        for (int i = 0; i < adaptive_sched.size(); i++) {
+            write_events(file, adaptive_sched.stage(i).name,
+                adaptive_sched.stats(i), stats_base[i]);
+        }
+        write_events(file, "accio", adaptive_sched.accio_stats(), accio_base);
+    } else if (counters) {
+        file << "Hardware counters are unavailable\n";
+    }
+    if (remote) {
+        // Both schedulers play through the server
+        file << "Round trips per game: "
+             << (double)(remote->round_trips() - trips_base) / (2 * games)
+             << '\n';
+    }
+    file << '\n';
     file.flush();
 }
 
+// Usage:
+//     deter_bench
+//         100 games at a time, written to deter_bench.log
+// The other benchmarks are executables of their own: ab_bench, order_bench,
+// tiles_bench, guess_bench and record_bench.
 int main() {
     std::ofstream file("deter_bench.log", std::ios::out | std::ios::app);
-    Butterfly butt;
+    Butterfly local;
+    if (const char* path = std::getenv("HOLY_BACKEND"))
+        remote = std::make_unique<RemoteBackend>(path);
+    add_solvers(adaptive_sched, advice);
+    add_solvers(fixed_sched, advice);
+    john_stage = adaptive_sched.find("john");
+    if (std::getenv("HOLY_PERF")) {
+        counters = std::make_unique<perf::Counters>();
+        adaptive_sched.count_events(counters.get());
+    }
+    // HOLY_TRACE names a file that gets the timeline of the last 100 games
+    const char* trace_path = std::getenv("HOLY_TRACE");
+    if (trace_path)
+        trace::start(trace_path);
+    reset_global();
     int exit = 0;
     std::cout << "Exit after 100 games? (1 or 0)\n";
     std::cin >> exit;
     while (true) {
         const int won_before = won;
-        main_loop(butt);
+        main_loop(local);
         if (won == won_before + 1)
             file << "w";
         else
@@ -101,8 +243,12 @@ int main() {
             file << '\n';
             write_data(file);
             reset_global();
+            if (trace_path)
+                trace::stop();
             if (exit)
                 break;
+            if (trace_path)
+                trace::start(trace_path);
         }
     }
-}
\ No newline at end of file
+}
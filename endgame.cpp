@@ -0,0 +1,106 @@
+#include "solvers.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    using namespace Holy;
+
+    // n choose k, or cap + 1 if that is more than cap
+    long long choose(int n, int k, long long cap) noexcept {
+        if (k < 0 || k > n)
+            return 0;
+        k = std::min(k, n - k);
+        unsigned long long ret = 1;
+        for (int i = 1; i <= k; i++) {
+            // Exact: ret is (n - k + i - 1) choose (i - 1) before
+            ret = ret * (n - k + i) / i;
+            if (ret > (unsigned long long)cap)
+                return cap + 1;
+        }
+        return ret;
+    }
+} // namespace
+
+namespace Holy {
+    std::optional<std::pair<bool, std::optional<MineChance>>>
+        endgame(GameData& game) {
+        // Bit i of a layout is the block cells[i]
+        Point cells[endgame_max_cells];
+        int n = 0;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status != Block::unknown)
+                    continue;
+                if (n == endgame_max_cells)
+                    return std::nullopt;
+                cells[n++] = p;
+            }
+        }
+        const int m = game.mines_left;
+        const long long layouts = choose(n, m, endgame_max_layouts);
+        if (layouts > endgame_max_layouts)
+            return std::nullopt;
+        // Each number with vacant blocks: the mask of them, and its elabel
+        std::uint64_t bit[hash_max] = {};
+        for (int i = 0; i < n; i++)
+            bit[cells[i].hash()] = 1ULL << i;
+        std::uint64_t masks[col * row];
+        int want[col * row];
+        int cons = 0;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                const Block& b = game[p];
+                if (b.status != Block::number || b.vacant_nei == 0)
+                    continue;
+                std::uint64_t mask = 0;
+                game.for_each_nei8(p, [&](Point np) {
+                    mask |= bit[np.hash()];
+                });
+                masks[cons] = mask;
+                want[cons++] = b.elabel;
+            }
+        }
+        // Layouts that fit, and how many of them have each block mined
+        double total = 0;
+        double mined[endgame_max_cells] = {};
+        // Gosper's hack: the next larger word with as many bits set
+        std::uint64_t s = m == 64 ? ~0ULL : (1ULL << m) - 1;
+        for (long long l = 0; l < layouts; l++) {
+            if (l > 0) {
+                const std::uint64_t c = s & -s;
+                const std::uint64_t r = s + c;
+                s = (((r ^ s) >> 2) >> __builtin_ctzll(c)) | r;
+            }
+            int k = 0;
+            while (k < cons && __builtin_popcountll(s & masks[k]) == want[k])
+                k++;
+            if (k < cons)
+                continue;
+            total++;
+            for (std::uint64_t x = s; x; x &= x - 1)
+                mined[__builtin_ctzll(x)]++;
+        }
+        if (total == 0)
+            throw std::runtime_error("No layout of the mines fits");
+        MineChance mc{ 0 };
+        bool det = false, guess = false;
+        Mark marks[endgame_max_cells] = {};
+        int cnt = 0;
+        for (int i = 0; i < n; i++) {
+            mc[cells[i].hash()] = std::lround(mined[i] / total * chance_scale);
+            if (mined[i] == total || mined[i] == 0) {
+                marks[cnt++] = { cells[i], mined[i] == total };
+                det = true;
+            } else if (mc[cells[i].hash()] * 3 / 2 >= chance_scale) {
+                guess = true;
+            }
+        }
+        game.mark_batch(marks, cnt);
+        if (det)
+            return std::make_pair(false, std::optional<MineChance>());
+        return std::make_pair(guess, std::make_optional(mc));
+    }
+} // namespace Holy
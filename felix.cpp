@@ -8,10 +8,10 @@ namespace {
         get_share_cnt(Holy::GameData& game, Holy::Point p) {
         using namespace Holy;
         std::array<int, Holy::hash_max> share_cnt{ 0 };
-        p.for_each_nei8([&](Point vacant) {
+        game.for_each_nei8(p, [&](Point vacant) {
             if (game[vacant].status != Block::unknown)
                 return;
-            vacant.for_each_nei8([&](Point nei2) {
+            game.for_each_nei8(vacant, [&](Point nei2) {
                 if (nei2 == p)
                     return;
                 if (game[nei2].status != Block::number)
@@ -30,11 +30,11 @@ namespace {
         // 1 if kept back, 2 if unused nei of center, 3 if both
         // std::map<Point, unsigned char> roles;
         std::array<unsigned char, hash_max> roles{ 0 };
-        p.for_each_nei8([&](Point nei) {
+        game.for_each_nei8(p, [&](Point nei) {
             if (game[nei].status == Block::unknown)
                 roles[nei.hash()] = 2; // = because initial value is 0
         });
-        nei2.for_each_nei8([&](Point nei) {
+        game.for_each_nei8(nei2, [&](Point nei) {
             if (game[nei].status == Block::unknown)
                 roles[nei.hash()] += 1;
         });
@@ -47,17 +47,17 @@ namespace {
         } */
         // The variable used in the loop
         Point nei;
+        // At most the neighbors of p and nei2
+        std::array<Mark, 16> marks;
+        int n = 0;
         for (nei.x = 1; nei.x <= col; nei.x++) {
             for (nei.y = 1; nei.y <= row; nei.y++) {
                 const int role = roles[nei.hash()];
-                if (role == 0)
-                    continue;
-                if (role == 1)
-                    game.mark_mine(nei);
-                else if (role == 2)
-                    game.mark_semiknown(nei);
+                if (role == 1 || role == 2)
+                    marks[n++] = { nei, role == 1 };
             }
         }
+        game.mark_batch(marks.data(), n);
     }
 
     // This function does the work.
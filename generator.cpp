@@ -0,0 +1,235 @@
+#include "generator.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    using namespace Holy;
+    using Rng = std::mt19937;
+
+    constexpr char magic[8] = { 'H', 'O', 'L', 'Y', 'B', 'R', 'D', '1' };
+    constexpr std::size_t header_size = 24;
+
+    // Makes the frontier of game, the board the solvers got stuck on,
+    // either all mines or all clear, whichever moves fewer mines, trading
+    // them with blocks the solvers have not reached. The numbers along the
+    // frontier then give it away to roundup().
+    // Returns the number of mines moved, 0 if neither can be done.
+    int repair(Checklist& mined, const GameData& game, Rng& rng) {
+        std::vector<Point> front, inner;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status != Block::unknown)
+                    continue;
+                bool near = false;
+                game.for_each_nei8(p, [&](Point np) {
+                    near = near || game[np].status == Block::number;
+                });
+                (near ? front : inner).push_back(p);
+            }
+        }
+        // Blocks around the first click are numbers by now, so neither
+        // list has any of them
+        std::vector<Point> front_mined, front_clear, inner_mined, inner_clear;
+        for (const auto& p : front)
+            (mined[p.hash()] ? front_mined : front_clear).push_back(p);
+        for (const auto& p : inner)
+            (mined[p.hash()] ? inner_mined : inner_clear).push_back(p);
+        const bool can_clear = !front_mined.empty()
+            && front_mined.size() <= inner_clear.size();
+        const bool can_fill = !front_clear.empty()
+            && front_clear.size() <= inner_mined.size();
+        if (!can_clear && !can_fill)
+            return 0;
+        const bool clear = can_clear
+            && (!can_fill || front_mined.size() <= front_clear.size());
+        auto& from = clear ? front_mined : front_clear;
+        auto& to = clear ? inner_clear : inner_mined;
+        std::shuffle(to.begin(), to.end(), rng);
+        for (std::size_t i = 0; i < from.size(); i++) {
+            mined.flip(from[i].hash());
+            mined.flip(to[i].hash());
+        }
+        return from.size();
+    }
+
+    // Takes the boards of out one at a time and makes each from its own
+    // stream, so what ends up in a slot does not depend on which thread
+    // made it or when
+    void worker(
+        const GeneratorConfig& config,
+        std::atomic<std::size_t>& next,
+        std::vector<Checklist>& out,
+        GeneratorStats& stats) {
+        GameData game;
+        for (std::size_t slot; (slot = next.fetch_add(1)) < out.size();) {
+            std::seed_seq seq{ config.seed, (unsigned)slot };
+            Rng rng(seq);
+            while (true) {
+                Checklist mined = draw_layout(config.first, rng);
+                stats.drawn++;
+                int rounds = 0;
+                bool won = solvable(mined, config.first, game);
+                while (!won && rounds < config.repairs) {
+                    const int moved = repair(mined, game, rng);
+                    if (moved == 0)
+                        break;
+                    rounds++;
+                    stats.moved += moved;
+                    won = solvable(mined, config.first, game);
+                }
+                stats.repairs += rounds;
+                if (!won)
+                    continue;
+                out[slot] = mined;
+                stats.kept++;
+                stats.kept_repaired += rounds > 0;
+                break;
+            }
+        }
+    }
+} // namespace
+
+namespace Holy {
+    Checklist draw_layout(Point first, std::mt19937& rng) {
+        std::array<Point, col * row> possible;
+        int cnt = 0;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                if (std::abs(ix - first.x) > 1 || std::abs(iy - first.y) > 1)
+                    possible[cnt++] = { ix, iy };
+            }
+        }
+        Checklist mined;
+        // A partial Fisher-Yates shuffle, the first mines are drawn
+        for (int i = 0; i < mines; i++) {
+            std::uniform_int_distribution<int> pick(i, cnt - 1);
+            std::swap(possible[i], possible[pick(rng)]);
+            mined[possible[i].hash()] = true;
+        }
+        return mined;
+    }
+
+    bool solvable(const Checklist& mined, Point first, GameData& game) {
+        // Each thread plays on its own
+        thread_local Butterfly butt;
+        thread_local Advice advice;
+        thread_local Scheduler sched = [] {
+            Scheduler ret;
+            add_solvers(ret, advice);
+            return ret;
+        }();
+        butt.start_game(first, mined);
+        game = GameData();
+        game.mark_semiknown(first);
+        accio(game, butt, true);
+        sched.solve(game, butt);
+        return butt.verify();
+    }
+
+    std::vector<Checklist> generate_boards(
+        std::size_t count,
+        const GeneratorConfig& config,
+        GeneratorStats* stats) {
+        int threads = config.threads;
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<Checklist> out(count);
+        std::atomic<std::size_t> next{ 0 };
+        std::vector<GeneratorStats> tallies(threads);
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) {
+            pool.emplace_back(
+                worker,
+                std::cref(config),
+                std::ref(next),
+                std::ref(out),
+                std::ref(tallies[t]));
+        }
+        worker(config, next, out, tallies[0]);
+        for (auto& th : pool)
+            th.join();
+        if (stats) {
+            *stats = {};
+            for (const auto& tally : tallies) {
+                stats->drawn += tally.drawn;
+                stats->repairs += tally.repairs;
+                stats->moved += tally.moved;
+                stats->kept += tally.kept;
+                stats->kept_repaired += tally.kept_repaired;
+            }
+        }
+        return out;
+    }
+
+    void write_boards(
+        const std::string& path,
+        Point first,
+        const std::vector<Checklist>& boards) {
+        std::vector<unsigned char> buf(
+            header_size + boards.size() * board_bytes, 0);
+        std::memcpy(buf.data(), magic, sizeof magic);
+        buf[8] = col;
+        buf[9] = row;
+        buf[10] = first.x;
+        buf[11] = first.y;
+        const std::uint16_t count_mines = mines;
+        std::memcpy(buf.data() + 12, &count_mines, 2);
+        const std::uint64_t count = boards.size();
+        std::memcpy(buf.data() + 16, &count, 8);
+        unsigned char* data = buf.data() + header_size;
+        for (const auto& mined : boards) {
+            for (int iy = 1; iy <= row; iy++) {
+                for (int ix = 1; ix <= col; ix++) {
+                    const int h = (iy - 1) * col + ix - 1;
+                    if (mined[Point{ ix, iy }.hash()])
+                        data[h / 8] |= 1 << (h % 8);
+                }
+            }
+            data += board_bytes;
+        }
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+        if (!file)
+            throw std::runtime_error("write_boards: cannot write " + path);
+    }
+
+    std::vector<Checklist> read_boards(const std::string& path, Point& first) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        unsigned char header[header_size];
+        if (!file.read(reinterpret_cast<char*>(header), header_size))
+            throw std::runtime_error("read_boards: cannot read " + path);
+        std::uint16_t count_mines;
+        std::uint64_t count;
+        std::memcpy(&count_mines, header + 12, 2);
+        std::memcpy(&count, header + 16, 8);
+        if (std::memcmp(header, magic, sizeof magic) != 0 || header[8] != col
+            || header[9] != row || count_mines != mines)
+            throw std::runtime_error("read_boards: not a board file for "
+                                     "this board: " + path);
+        first = { header[10], header[11] };
+        if (!first.valid())
+            throw std::runtime_error("read_boards: bad first click in " + path);
+        std::vector<Checklist> boards;
+        std::array<unsigned char, board_bytes> data;
+        for (std::uint64_t i = 0; i < count; i++) {
+            if (!file.read(reinterpret_cast<char*>(data.data()), board_bytes))
+                throw std::runtime_error("read_boards: truncated " + path);
+            Checklist& mined = boards.emplace_back();
+            for (int iy = 1; iy <= row; iy++) {
+                for (int ix = 1; ix <= col; ix++) {
+                    const int h = (iy - 1) * col + ix - 1;
+                    if (data[h / 8] >> (h % 8) & 1)
+                        mined[Point{ ix, iy }.hash()] = true;
+                }
+            }
+        }
+        return boards;
+    }
+} // namespace Holy
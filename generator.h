@@ -0,0 +1,83 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "scheduler.h"
+#include <random>
+#include <string>
+
+/// @file generator.h Boards that can be won without guessing
+/// A layout is drawn the way Butterfly::start_game() draws one, then played
+/// by the deterministic solvers. Layouts on which they get stuck are either
+/// drawn again or repaired: the frontier where they stopped is made all
+/// mines or all clear, trading mines with the blocks beyond it, and the
+/// board is played again from the first click.
+
+namespace Holy {
+    /// @brief Bytes of a board in a board file
+    constexpr int board_bytes = (col * row + 7) / 8;
+
+    /// @brief Parameters of generate_boards()
+    struct GeneratorConfig {
+        /// Worker threads, 0 means one per hardware thread.
+        int threads = 0;
+        /// The first click of every board
+        Point first{ 10, 10 };
+        /// Repairs of a board before it is drawn again, 0 to never repair
+        int repairs = 4;
+        /// Base seed, board i is drawn from the stream seeded by (seed, i),
+        /// so the boards do not depend on the number of threads
+        unsigned seed = 20201;
+    };
+
+    /// @brief What generate_boards() went through
+    struct GeneratorStats {
+        /// Layouts drawn from scratch
+        long long drawn = 0;
+        /// Repairs made, and mines moved by them
+        long long repairs = 0, moved = 0;
+        /// Boards kept, and how many of those were repaired
+        long long kept = 0, kept_repaired = 0;
+    };
+
+    /// @brief Draws mines uniformly among the blocks not around first, the
+    /// way Butterfly::start_game() does
+    /// @returns the mines, by Point::hash()
+    Checklist draw_layout(Point first, std::mt19937& rng);
+
+    /// @brief Plays the board with the given mines, by Point::hash(), from
+    /// first with roundup(), felix() and john()'s deterministic moves
+    /// @param game -- receives the board where the solvers stopped
+    /// @returns whether they won it
+    /// @exception std::invalid_argument as Butterfly::start_game()
+    bool solvable(const Checklist& mined, Point first, GameData& game);
+
+    /// @brief Makes count boards that solvable() wins, in parallel
+    /// @returns the mines of each board, by Point::hash(), the same for
+    /// any number of threads
+    /// @exception This function only transmits exceptions.
+    std::vector<Checklist> generate_boards(
+        std::size_t count,
+        const GeneratorConfig& config = {},
+        GeneratorStats* stats = nullptr);
+
+    /// @brief Writes boards that start at first to a board file at path
+    ///
+    /// A board file is, integers in native byte order, "HOLYBRD1", col,
+    /// row, the x and y of first as uint8, mines as uint16, 2 reserved
+    /// bytes, a uint64 count of boards, then each board in board_bytes
+    /// bytes, the bit of block h = (y - 1) * col + x - 1 being bit h % 8 of
+    /// byte h / 8.
+    /// @exception std::runtime_error if the file cannot be written
+    void write_boards(
+        const std::string& path,
+        Point first,
+        const std::vector<Checklist>& boards);
+
+    /// @brief Reads the board file at path written by write_boards()
+    /// @param first -- receives the first click of the boards
+    /// @exception std::runtime_error if the file cannot be read, is
+    /// malformed or is for another size of board
+    std::vector<Checklist> read_boards(const std::string& path, Point& first);
+} // namespace Holy
+
+#endif // GENERATOR_H
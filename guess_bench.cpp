@@ -0,0 +1,95 @@
+// Contains main()
+// Measures what guessing by lookahead wins
+// Usage: guess_bench [games] [seed]
+//     games -- 200 by default
+// Seeded layouts are played to the end, guessing whenever the solvers are
+// stuck, once with the safest block and once with the pick of
+// evaluate_guesses(), and the win rates are compared game by game.
+#include "generator.h"
+#include "lookahead.h"
+#include "running.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace Holy;
+
+namespace {
+    // Plays the layout mined, guessing by lookahead if it is set, and returns
+    // whether the game is won. Counts the guesses, and the time spent choosing
+    // them.
+    bool play_guessing(Butterfly& butt, Scheduler& sched, Advice& advice,
+        const Checklist& mined, bool lookahead, long long& guesses,
+        std::chrono::nanoseconds& choosing) {
+        using namespace std::chrono;
+        butt.start_game({ 10, 10 }, mined);
+        GameData game;
+        game.mark_semiknown({ 10, 10 });
+        accio(game, butt, true);
+        while (true) {
+            advice = {};
+            sched.solve(game, butt);
+            if (butt.verify())
+                return true;
+            if (!advice.chance)
+                return false;
+            LookaheadConfig config;
+            // One thread and no deadline, so the pick depends on the board only
+            config.threads = 1;
+            config.budget = hours(1);
+            if (!lookahead)
+                config.candidates = 1;
+            const auto start = steady_clock::now();
+            const Point p = evaluate_guesses(game, *advice.chance, config)[0].p;
+            choosing += steady_clock::now() - start;
+            guesses++;
+            game.mark_semiknown(p);
+            if (!accio(game, butt, false))
+                return false;
+        }
+    }
+
+    void run_guess(long long games, unsigned seed) {
+        using namespace std::chrono;
+        Advice advice_a, advice_b;
+        Scheduler sched_a, sched_b;
+        add_solvers(sched_a, advice_a);
+        add_solvers(sched_b, advice_b);
+        Butterfly butt;
+        // B minus A, game by game
+        Running win_a, win_b, win;
+        long long guesses_a = 0, guesses_b = 0;
+        nanoseconds choosing_a{ 0 }, choosing_b{ 0 };
+        for (long long g = 0; g < games; g++) {
+            std::seed_seq seq{ seed, (unsigned)g };
+            std::mt19937 rng(seq);
+            const Checklist mined = draw_layout({ 10, 10 }, rng);
+            const bool a = play_guessing(
+                butt, sched_a, advice_a, mined, false, guesses_a, choosing_a);
+            const bool b = play_guessing(
+                butt, sched_b, advice_b, mined, true, guesses_b, choosing_b);
+            win_a.add(a);
+            win_b.add(b);
+            win.add((double)b - a);
+        }
+        std::cout << "A safest block, B lookahead: " << games
+                  << " paired games\n";
+        write_interval(std::cout, "    win rate A ", win_a);
+        write_interval(std::cout, "    B ", win_b);
+        write_interval(std::cout, "\n    B - A ", win);
+        std::cout << "    p " << win.p_value() << '\n';
+        std::cout << "    guesses per game A " << (double)guesses_a / games
+                  << "    B " << (double)guesses_b / games
+                  << "\n    us per guess chosen A "
+                  << choosing_a.count() / 1000.0 / std::max(guesses_a, 1LL)
+                  << "    B "
+                  << choosing_b.count() / 1000.0 / std::max(guesses_b, 1LL)
+                  << '\n';
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    run_guess(argc > 1 ? std::atoll(argv[1]) : 200,
+        argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20201);
+}
@@ -1,12 +1,22 @@
+#include "arena.h"
+#include "kernel.h"
+#include "patterns.h"
 #include "solvers.h"
+#include <algorithm>
 #include <bitset>
-#include <cassert>
+#include <cmath>
+#include <stdexcept>
 
 namespace {
     using namespace Holy;
+    using Entry = JohnCache::Entry;
 
-    // Dummy class to indicate that we should stop iteration
-    struct StopIteration {};
+    // Nodes the search of one component may visit before it is cut off
+    constexpr long long node_cap = 1 << 21;
+
+    // Walks sample_front() makes on a component that was cut off, about as
+    // long as the 200ms it used to be given on one thread
+    constexpr long long sample_walks = 20000;
 
     // Finds the frontier where the search takes place
     // Output written to front
@@ -18,7 +28,7 @@ namespace {
                 Point p{ ix, iy };
                 if (game[p].status == Block::number && game[p].elabel) {
                     // Which means there is another mine hidden in nei of p
-                    p.for_each_nei8([&](Point np) {
+                    game.for_each_nei8(p, [&](Point np) {
                         if (game[np].status == Block::unknown)
                             vis[np.hash()] = true;
                     });
@@ -35,6 +45,43 @@ namespace {
         }
     }
 
+    // Splits the frontier into components, two blocks are in the same
+    // component if they are linked by a chain of shared numbers.
+    // Blocks in each component keep the order of the frontier.
+    std::pmr::vector<Frontier>
+        split_front(const GameData& game, const Frontier& front) {
+        auto* res = front.get_allocator().resource();
+        Checklist in_front, seen;
+        for (const auto& p : front)
+            in_front[p.hash()] = true;
+        std::pmr::vector<Frontier> comps(res);
+        Frontier stack(res);
+        for (const auto& start : front) {
+            if (seen[start.hash()])
+                continue;
+            comps.emplace_back();
+            seen[start.hash()] = true;
+            stack.push_back(start);
+            while (!stack.empty()) {
+                Point p = stack.back();
+                stack.pop_back();
+                comps.back().push_back(p);
+                game.for_each_nei8(p, [&](Point num) {
+                    if (!game[num].second_init)
+                        return;
+                    game.for_each_nei8(num, [&](Point np) {
+                        if (in_front[np.hash()] && !seen[np.hash()]) {
+                            seen[np.hash()] = true;
+                            stack.push_back(np);
+                        }
+                    });
+                });
+            }
+            std::sort(comps.back().begin(), comps.back().end());
+        }
+        return comps;
+    }
+
     // Generally we don't cut up the frontier because of mines_left
 
     // Check for inconsistency with center p, also if mines_left < 0
@@ -55,86 +102,262 @@ namespace {
         return true;
     }
 
-    // The actual searching happens here.
-    // We cannot call felix and roundup here because we'll have trouble
-    // redoing if we guessed wrong
-    // We're at the kth element of frontier.
-    // If we find a reasonable solution, append it to ans.
-    // Doesn't use Checklist to store answer because constructing Checklist
-    // takes too much time. See commit msg for details.
-    void
-        dfs(GameData& game,
-            const Frontier& front,
-            int k,
-            std::vector<GameData>& ans) {
-        if (k == front.size()) {
-            // Reached end of recursion, success
-            ans.push_back(game);
-            if (ans.size() >= 100000)
-                throw StopIteration();
-            return;
-        }
-        Point p = front[k];
-        // First check if this is set in previous guesses
-        if (game[p].status != Block::unknown) {
-            // move on
-            dfs(game, front, k + 1, ans);
-            return;
+    // Multiplies two polynomials given by their coefficients
+    // The result allocates where a does
+    std::pmr::vector<double> convolve(
+        const std::pmr::vector<double>& a,
+        const double* b,
+        int b_size) {
+        std::pmr::vector<double> ret(
+            a.size() + b_size - 1, 0, a.get_allocator());
+        for (int i = 0; i < (int)a.size(); i++) {
+            for (int j = 0; j < b_size; j++)
+                ret[i + j] += a[i] * b[j];
         }
-        // First guess: mine
-        if (game.mark_mine_check(p)) {
-            // If enters here, this is a good guess and will be reverted later
-            // If not, revertion already done in check
-            dfs(game, front, k + 1, ans);
-            game.unmark_mine(p);
+        return ret;
+    }
+
+    // The counts of a component on n blocks, as written by
+    // FrontKernel::count(): ways[j] at j, mined[i][j] at n + 1 + i * (n + 1) + j
+    struct Counts {
+        int n = 0;
+        std::pmr::vector<double> flat;
+
+        const double* ways() const noexcept {
+            return flat.data();
         }
-        // Second guess: not a mine
-        if (game.mark_semiknown_check(p)) {
-            dfs(game, front, k + 1, ans);
-            game.unmark_semiknown(p);
+
+        const double* mined() const noexcept {
+            return flat.data() + n + 1;
         }
-    }
+    };
 } // namespace
 
 namespace Holy {
+    std::pmr::vector<Frontier> front_components(
+        const GameData& game,
+        std::pmr::memory_resource* res) {
+        Frontier front(res);
+        find_front(game, front);
+        return split_front(game, front);
+    }
+
+    JohnCache::JohnCache(std::size_t capacity) :
+        mPool(std::make_unique<std::pmr::unsynchronized_pool_resource>()),
+        mEntries(mPool.get()),
+        mCapacity(capacity) {}
+
+    const double* JohnCache::find(std::uint64_t key, int n) {
+        auto it = mEntries.find(key);
+        if (it == mEntries.end() || it->second.n != n) {
+            mMisses++;
+            return nullptr;
+        }
+        mHits++;
+        return mCounts.data() + it->second.offset;
+    }
+
+    bool JohnCache::contains(std::uint64_t key, int n) const noexcept {
+        auto it = mEntries.find(key);
+        return it != mEntries.end() && it->second.n == n;
+    }
+
+    void JohnCache::insert(std::uint64_t key, int n, const double* counts) {
+        const std::size_t size = (n + 1) * (n + 1);
+        if (mCounts.size() + size > mCapacity)
+            clear();
+        auto [it, inserted] = mEntries.try_emplace(key, Slot{ n, 0 });
+        if (!inserted)
+            return;
+        it->second.offset = mCounts.size();
+        mCounts.insert(mCounts.end(), counts, counts + size);
+    }
+
+    void JohnCache::clear() noexcept {
+        mEntries.clear();
+        mCounts.clear();
+    }
+
+    std::size_t JohnCache::hits() const noexcept {
+        return mHits;
+    }
+
+    std::size_t JohnCache::misses() const noexcept {
+        return mMisses;
+    }
+
+    void JohnCache::use_store(const PatternStore* store) noexcept {
+        mStore = store;
+    }
+
+    const PatternStore* JohnCache::store() const noexcept {
+        return mStore;
+    }
+
+    void JohnCache::record_to(PatternBuilder* builder) noexcept {
+        mRecorder = builder;
+    }
+
+    PatternBuilder* JohnCache::recorder() const noexcept {
+        return mRecorder;
+    }
+
     std::pair<bool, std::optional<MineChance>> john(GameData& game) {
-        std::vector<GameData> ans;
-        Frontier front;
-        bool search_done = true;
+        // Components recur from one call to the next within a game,
+        // and across games through the shared pattern store
+        thread_local JohnCache cache = [] {
+            JohnCache ret;
+            ret.use_store(PatternStore::shared());
+            return ret;
+        }();
+        return john(game, cache);
+    }
+
+    std::pair<bool, std::optional<MineChance>>
+        john(GameData& game, JohnCache& cache) {
+        return john(game, cache, Arena::local());
+    }
+
+    std::pair<bool, std::optional<MineChance>>
+        john(GameData& game, JohnCache& cache, Arena& arena) {
+        // Few enough layouts left to try them all
+        if (auto ret = endgame(game))
+            return *ret;
+        arena.reset();
+        auto* res = arena.resource();
+        Frontier front(res);
         find_front(game, front);
-        try {
-            dfs(game, front, 0, ans);
-        } catch (const StopIteration&) {
-            search_done = false;
-            // FIXME: Is it correct to just carry on and ignore this?
+        const auto comps = split_front(game, front);
+        const int cnt = comps.size();
+        std::pmr::vector<Counts> counts(res);
+        counts.reserve(cnt);
+        // Components whose search was cut off
+        std::pmr::vector<bool> cut(cnt, false, res);
+        bool search_done = true;
+        for (int c = 0; c < cnt; c++) {
+            const auto& comp = comps[c];
+            const int n = comp.size();
+            counts.push_back({ n, std::pmr::vector<double>(res) });
+            auto& flat = counts[c].flat;
+            FrontKernel kernel(game, comp, res);
+            const PatternStore* store = cache.store();
+            if (store && n <= pattern_max_cells
+                && !cache.contains(kernel.key(), n)) {
+                flat.resize((n + 1) * (n + 1));
+                if (store->find(game, comp, flat.data())) {
+                    cache.insert(kernel.key(), n, flat.data());
+                    continue;
+                }
+            }
+            if (kernel.count(cache, node_cap, flat)) {
+                if (PatternBuilder* recorder = cache.recorder()) {
+                    Entry e;
+                    e.n = n;
+                    e.ways.assign(flat.begin(), flat.begin() + n + 1);
+                    e.mined.assign(flat.begin() + n + 1, flat.end());
+                    recorder->add(game, comp, e);
+                }
+            } else {
+                cut[c] = true;
+                search_done = false;
+                // Leave this component out of the combination
+                counts[c].n = 0;
+                flat.assign(1, 1);
+            }
+        }
+        // How many ways the components before c and after c can have t mines
+        std::pmr::vector<std::pmr::vector<double>> before(cnt + 1, res),
+            after(cnt + 1, res);
+        before[0] = after[cnt] = { 1 };
+        for (int c = 0; c < cnt; c++) {
+            before[c + 1] =
+                convolve(before[c], counts[c].ways(), counts[c].n + 1);
         }
-        assert(ans.size());
+        for (int c = cnt - 1; c >= 0; c--)
+            after[c] = convolve(after[c + 1], counts[c].ways(), counts[c].n + 1);
         // The result of this call
         MineChance mc{ 0 };
-        for (const auto& solution : ans) {
-            for (const auto& p : front) {
-                if (solution[p].status == Block::mine)
-                    mc[p.hash()]++;
-            }
-        }
         bool det = false, guess = false;
-        // Check for deterministic behaviours only if no StopIteration
-        if (search_done) {
-            for (const auto& p : front) {
-                const int chance = mc[p.hash()];
-                if (chance == ans.size()) {
-                    game.mark_mine(p);
-                    det = true;
-                } else if (chance == 0) {
-                    game.mark_semiknown(p);
+        // Deterministic marks, made once the map is done
+        std::pmr::vector<Mark> marks(res);
+        const int left = game.mines_left;
+        for (int c = 0; c < cnt; c++) {
+            const auto& comp = comps[c];
+            // upto[t]: ways for the other components to have at most t mines
+            const auto others =
+                convolve(before[c], after[c + 1].data(), after[c + 1].size());
+            std::pmr::vector<double> upto(left + 1, 0, res);
+            for (int t = 0; t <= left; t++) {
+                const double here = t < (int)others.size() ? others[t] : 0;
+                upto[t] = (t ? upto[t - 1] : 0) + here;
+            }
+            if (cut[c]) {
+                // Too many cases to enumerate, estimate the map instead.
+                // The caller may be one of many threads, and the map should
+                // not depend on timing, so the walks run here and stop at a
+                // count rather than a deadline.
+                SamplerConfig config;
+                config.threads = 1;
+                config.budget = std::chrono::milliseconds(0);
+                config.samples = sample_walks;
+                const int size = std::min<int>(comp.size(), left);
+                config.mine_weights.assign(size + 1, 0);
+                for (int j = 0; j <= size; j++)
+                    config.mine_weights[j] = upto[left - j];
+                // Scaled so the squared weights of the walks stay finite
+                const double top = *std::max_element(
+                    config.mine_weights.begin(), config.mine_weights.end());
+                if (top > 0) {
+                    for (auto& w : config.mine_weights)
+                        w /= top;
+                }
+                const auto est = sample_front(game, comp, config);
+                // The upper end of the interval, so a guess is made here
+                // only if it beats the exact chances elsewhere when the
+                // estimate is off
+                for (const auto& p : comp) {
+                    mc[p.hash()] =
+                        std::lround(est.high[p.hash()] * chance_scale);
+                }
+                continue;
+            }
+            const int n = counts[c].n;
+            const double* ways = counts[c].ways();
+            const double* mined_ways = counts[c].mined();
+            // Weight of the solutions of this component with j mines
+            std::pmr::vector<double> weight(n + 1, 0, res);
+            double total = 0;
+            for (int j = 0; j <= n && j <= left; j++) {
+                weight[j] = upto[left - j];
+                total += ways[j] * weight[j];
+            }
+            // Only a board that no layout of the mines fits, such as one
+            // sent by a client, gets here
+            if (!(total > 0))
+                throw std::runtime_error("No layout of the mines fits");
+            for (int i = 0; i < n; i++) {
+                const Point p = comp[i];
+                double mined = 0, safe = 0;
+                for (int j = 0; j <= n; j++) {
+                    mined += mined_ways[i * (n + 1) + j] * weight[j];
+                    safe += (ways[j] - mined_ways[i * (n + 1) + j]) * weight[j];
+                }
+                mc[p.hash()] = std::lround(mined / total * chance_scale);
+                // Check for deterministic behaviours only if nothing was cut off
+                if (search_done && (safe == 0 || mined == 0)) {
+                    marks.push_back({ p, safe == 0 });
                     det = true;
-                } else if (chance * 3 / 2 >= ans.size())
-                    // FIXME: 2 / 3 is an arbitary value, needs experiment.
-                    guess = true;
+                }
             }
         }
+        for (const auto& p : front) {
+            // FIXME: 2 / 3 is an arbitary value, needs experiment.
+            if (mc[p.hash()] * 3 / 2 >= chance_scale)
+                guess = true;
+        }
+        game.mark_batch(marks.data(), marks.size());
         if (det)
             return { false, std::nullopt };
         return { guess, mc };
     }
-} // namespace Holy
\ No newline at end of file
+} // namespace Holy
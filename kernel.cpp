@@ -0,0 +1,422 @@
+#include "kernel.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+    using Holy::JohnCache;
+
+    // Adds the counts of a state with rem blocks left into the counts of
+    // its parent, where the block assigned in between is row at of rem + 1.
+    // Counts are laid out as in JohnCache::Entry, ways then mined.
+    void
+        merge(double* parent, const double* child, int rem, int mine, int at) {
+        const int prem = rem + 1;
+        double* pmined = parent + prem + 1;
+        for (int j = 0; j <= rem; j++) {
+            parent[j + mine] += child[j];
+            pmined[at * (prem + 1) + j + 1] += mine * child[j];
+        }
+        // The rows of the child skip that of the block
+        const double* cmined = child + rem + 1;
+        for (int i = 0; i < rem; i++) {
+            double* prow = pmined + (i + (i >= at)) * (prem + 1) + mine;
+            const double* crow = cmined + i * (rem + 1);
+            for (int j = 0; j <= rem; j++)
+                prow[j] += crow[j];
+        }
+    }
+} // namespace
+
+namespace Holy {
+    const char* name(Ordering o) noexcept {
+        switch (o) {
+            case Ordering::scan:
+                return "scan";
+            case Ordering::bfs:
+                return "bfs";
+            case Ordering::constrained:
+                return "constrained";
+            case Ordering::dynamic:
+                return "dynamic";
+        }
+        return "?";
+    }
+
+    FrontKernel::FrontKernel(
+        const GameData& game,
+        const Frontier& comp,
+        std::pmr::memory_resource* res,
+        Ordering order) :
+        mN(comp.size()),
+        mWords((comp.size() + 63) / 64),
+        mPos(res),
+        mLabel(res),
+        mVacant(res),
+        mMaskStart(res),
+        mMasks(res),
+        mVarStart(res),
+        mVarCons(res),
+        mMine(mWords, 0, res),
+        mDone(mWords, 0, res),
+        mConsKey(res),
+        mCurLabel(res),
+        mCurVacant(res),
+        mCellKey(res),
+        mOrdering(order),
+        mOrder(res),
+        mGoodStart(1, 0, res),
+        mGoodVars(res),
+        mGoodHits(res),
+        mWatch(2 * comp.size(), res) {
+        std::array<int, hash_max> index;
+        index.fill(-1);
+        for (int v = 0; v < mN; v++) {
+            index[comp[v].hash()] = v;
+            mCellKey.push_back(cell_key(comp[v]));
+            mFree ^= mCellKey[v];
+        }
+        // Number blocks around comp, each becomes a constraint
+        Checklist seen;
+        std::pmr::vector<std::pmr::vector<int>> var_cons(mN, res);
+        mMaskStart.push_back(0);
+        for (const auto& p : comp) {
+            game.for_each_nei8(p, [&](Point np) {
+                const Block& nb = game[np];
+                if (!nb.second_init || seen[np.hash()])
+                    return;
+                seen[np.hash()] = true;
+                const int c = mPos.size();
+                mPos.push_back(np);
+                mLabel.push_back(nb.elabel);
+                mVacant.push_back(nb.vacant_nei);
+                std::pmr::vector<std::uint64_t> mask(mWords, 0, res);
+                game.for_each_nei8(np, [&](Point q) {
+                    const int v = index[q.hash()];
+                    if (v < 0)
+                        return;
+                    mask[v / 64] |= 1ULL << (v % 64);
+                    var_cons[v].push_back(c);
+                });
+                for (int w = 0; w < mWords; w++) {
+                    if (mask[w])
+                        mMasks.emplace_back(w, mask[w]);
+                }
+                mMaskStart.push_back(mMasks.size());
+                mConsKey.push_back(sig_key(np.index(), nb.elabel, nb.vacant_nei));
+                mSig ^= mConsKey.back();
+            });
+        }
+        mVarStart.push_back(0);
+        for (const auto& list : var_cons) {
+            mVarCons.insert(mVarCons.end(), list.begin(), list.end());
+            mVarStart.push_back(mVarCons.size());
+        }
+        mCurLabel = mLabel;
+        mCurVacant = mVacant;
+        mOrder.resize(mN);
+        for (int v = 0; v < mN; v++)
+            mOrder[v] = v;
+        if (order == Ordering::constrained) {
+            std::stable_sort(mOrder.begin(), mOrder.end(), [&](int a, int b) {
+                return mVarStart[a + 1] - mVarStart[a]
+                    > mVarStart[b + 1] - mVarStart[b];
+            });
+        } else if (order == Ordering::bfs) {
+            // The blocks of each number in turn, from the oldest block, and
+            // from the next one not reached if comp is not connected
+            std::pmr::vector<bool> queued(mN, false, res);
+            for (int head = 0, tail = 0, next = 0; head < mN; head++) {
+                if (head == tail) {
+                    while (queued[next])
+                        next++;
+                    queued[next] = true;
+                    mOrder[tail++] = next;
+                }
+                const int v = mOrder[head];
+                for (int i = mVarStart[v]; i < mVarStart[v + 1]; i++) {
+                    const int c = mVarCons[i];
+                    for (int m = mMaskStart[c]; m < mMaskStart[c + 1]; m++) {
+                        auto [w, mask] = mMasks[m];
+                        for (; mask; mask &= mask - 1) {
+                            const int u = w * 64 + __builtin_ctzll(mask);
+                            if (!queued[u]) {
+                                queued[u] = true;
+                                mOrder[tail++] = u;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::uint64_t FrontKernel::key() const noexcept {
+        return mSig ^ mFree;
+    }
+
+    long long FrontKernel::nodes() const noexcept {
+        return mNodes;
+    }
+
+    void FrontKernel::learn(bool on) noexcept {
+        mLearn = on;
+    }
+
+    int FrontKernel::nogoods() const noexcept {
+        return mGoodHits.size();
+    }
+
+    bool FrontKernel::update(int c) noexcept {
+        int mined = 0, assigned = 0;
+        for (int i = mMaskStart[c]; i < mMaskStart[c + 1]; i++) {
+            const auto [w, mask] = mMasks[i];
+            mined += __builtin_popcountll(mMine[w] & mask);
+            assigned += __builtin_popcountll(mDone[w] & mask);
+        }
+        const int elabel = mLabel[c] - mined;
+        const int vacant = mVacant[c] - assigned;
+        mCurLabel[c] = elabel;
+        mCurVacant[c] = vacant;
+        mSig ^= mConsKey[c];
+        mConsKey[c] = sig_key(mPos[c].index(), elabel, vacant);
+        mSig ^= mConsKey[c];
+        // Same rules as GameData::mark_mine_check and mark_semiknown_check
+        return (elabel >= 0) & (vacant >= elabel);
+    }
+
+    bool FrontKernel::assign(int v, bool mine) noexcept {
+        const std::uint64_t bit = 1ULL << (v % 64);
+        mDone[v / 64] |= bit;
+        mMine[v / 64] |= mine ? bit : 0;
+        mFree ^= mCellKey[v];
+        bool ok = true;
+        for (int i = mVarStart[v]; i < mVarStart[v + 1]; i++)
+            ok &= update(mVarCons[i]);
+        for (int g : mWatch[2 * v + mine])
+            ok &= ++mGoodHits[g] < mGoodStart[g + 1] - mGoodStart[g];
+        return ok;
+    }
+
+    void FrontKernel::unassign(int v) noexcept {
+        const std::uint64_t bit = 1ULL << (v % 64);
+        const bool mine = mMine[v / 64] & bit;
+        mDone[v / 64] &= ~bit;
+        mMine[v / 64] &= ~bit;
+        mFree ^= mCellKey[v];
+        for (int i = mVarStart[v]; i < mVarStart[v + 1]; i++)
+            update(mVarCons[i]);
+        for (int g : mWatch[2 * v + mine])
+            mGoodHits[g]--;
+    }
+
+    void FrontKernel::explain(int v, std::uint64_t* out) const noexcept {
+        std::fill(out, out + mWords, 0);
+        for (int i = mVarStart[v]; i < mVarStart[v + 1]; i++) {
+            const int c = mVarCons[i];
+            // Too many mines, or too many safe blocks
+            const bool mined = mCurLabel[c] < 0;
+            if (!mined && mCurVacant[c] >= mCurLabel[c])
+                continue;
+            for (int m = mMaskStart[c]; m < mMaskStart[c + 1]; m++) {
+                const auto [w, mask] = mMasks[m];
+                out[w] = mask & mDone[w] & (mined ? mMine[w] : ~mMine[w]);
+            }
+            return;
+        }
+        const bool mine = mMine[v / 64] >> (v % 64) & 1;
+        for (int g : mWatch[2 * v + mine]) {
+            if (mGoodHits[g] < mGoodStart[g + 1] - mGoodStart[g])
+                continue;
+            for (int i = mGoodStart[g]; i < mGoodStart[g + 1]; i++)
+                out[mGoodVars[i] / 64] |= 1ULL << (mGoodVars[i] % 64);
+            return;
+        }
+    }
+
+    void FrontKernel::add_nogood(const std::uint64_t* mask) {
+        int size = 0;
+        for (int w = 0; w < mWords; w++)
+            size += __builtin_popcountll(mask[w]);
+        if (size == 0 || size > nogood_max_size
+            || (int)mGoodHits.size() >= nogood_max)
+            return;
+        const int g = mGoodHits.size();
+        for (int w = 0; w < mWords; w++) {
+            for (std::uint64_t m = mask[w]; m; m &= m - 1) {
+                const int u = w * 64 + __builtin_ctzll(m);
+                mGoodVars.push_back(u);
+                mWatch[2 * u + (mMine[w] >> (u % 64) & 1)].push_back(g);
+            }
+        }
+        mGoodStart.push_back(mGoodVars.size());
+        // The blocks hold their values now
+        mGoodHits.push_back(size);
+    }
+
+    int FrontKernel::choose() const noexcept {
+        // Numbers with a block assigned already are preferred, so the search
+        // closes the numbers it has opened
+        int best = -1, best_slack = INT_MAX, best_vacant = INT_MAX;
+        bool best_touched = false;
+        for (int c = 0; c < (int)mPos.size(); c++) {
+            const int vacant = mCurVacant[c];
+            if (vacant == 0 || (vacant == mVacant[c] && best_touched))
+                continue;
+            const bool touched = vacant < mVacant[c];
+            if (touched && !best_touched) {
+                best_touched = true;
+                best_slack = INT_MAX;
+            }
+            const int slack = std::min(mCurLabel[c], vacant - mCurLabel[c]);
+            if (slack < best_slack
+                || (slack == best_slack && vacant < best_vacant)) {
+                best = c;
+                best_slack = slack;
+                best_vacant = vacant;
+            }
+        }
+        if (best >= 0) {
+            for (int m = mMaskStart[best]; m < mMaskStart[best + 1]; m++) {
+                const auto [w, mask] = mMasks[m];
+                if (const std::uint64_t left = mask & ~mDone[w])
+                    return w * 64 + __builtin_ctzll(left);
+            }
+        }
+        // Every block is next to a number, so this is not reached
+        for (int w = 0; w < mWords; w++) {
+            if (const std::uint64_t left = ~mDone[w])
+                return w * 64 + __builtin_ctzll(left);
+        }
+        return -1;
+    }
+
+    int FrontKernel::rank(int v) const noexcept {
+        int ret = 0;
+        for (int w = 0; w < v / 64; w++)
+            ret += __builtin_popcountll(~mDone[w]);
+        const std::uint64_t below = (1ULL << (v % 64)) - 1;
+        return ret + __builtin_popcountll(~mDone[v / 64] & below);
+    }
+
+    bool FrontKernel::count(
+        JohnCache& cache,
+        long long node_cap,
+        std::pmr::vector<double>& out) {
+        const int n = mN;
+        auto* res = mPos.get_allocator().resource();
+        // Counts of the state at depth k live at offset[k] in one buffer,
+        // (n - k + 1)^2 numbers each
+        std::pmr::vector<std::size_t> offset(n + 2, 0, res);
+        for (int k = 0; k <= n; k++)
+            offset[k + 1] = offset[k] + (n - k + 1) * (n - k + 1);
+        std::pmr::vector<double> counts(offset[n + 1], res);
+        // stage[k]: 0 entering depth k, 1 searching under a mine at block k,
+        // 2 searching under a safe block k
+        std::pmr::vector<char> stage(n + 1, 0, res);
+        // solved[k]: whether the state at depth k has a solution so far.
+        // Until it has, conflict[k] holds the blocks above it that rule out
+        // its branches so far.
+        std::pmr::vector<char> solved(n + 1, 0, res);
+        std::pmr::vector<std::uint64_t> conflict((n + 1) * mWords, 0, res);
+        std::pmr::vector<std::uint64_t> why(mWords, 0, res);
+        // A branch of the state at depth k on block v has no solution, as
+        // the blocks in f rule it out. Returns whether f leaves v out, so
+        // the other branch has none either.
+        const auto refute = [&](int k, int v, const std::uint64_t* f) {
+            if (!mLearn)
+                return false;
+            std::uint64_t* to = conflict.data() + k * mWords;
+            const std::uint64_t bit = 1ULL << (v % 64);
+            if (!(f[v / 64] & bit)) {
+                std::copy(f, f + mWords, to);
+                return true;
+            }
+            for (int w = 0; w < mWords; w++)
+                to[w] |= f[w];
+            to[v / 64] &= ~bit;
+            return false;
+        };
+        int k = 0;
+        while (true) {
+            const int rem = n - k;
+            double* here = counts.data() + offset[k];
+            const int size = (rem + 1) * (rem + 1);
+            // Whether the counts of this state are complete
+            bool done = false;
+            if (stage[k] == 0) {
+                std::fill(here, here + size, 0.0);
+                solved[k] = false;
+                std::fill_n(conflict.begin() + k * mWords, mWords, 0);
+                if (rem == 0) {
+                    // Reached the end, success
+                    here[0] = 1;
+                    solved[k] = true;
+                    done = true;
+                } else if (++mNodes > node_cap) {
+                    // Leave the kernel in its initial state
+                    for (int d = k - 1; d >= 0; d--)
+                        unassign(mOrder[d]);
+                    return false;
+                } else if (const double* hit = cache.find(key(), rem)) {
+                    std::copy(hit, hit + size, here);
+                    solved[k] = std::any_of(
+                        here, here + rem + 1, [](double x) { return x > 0; });
+                    // Which of the blocks above rule it out is not known
+                    if (mLearn && !solved[k])
+                        std::copy(mDone.begin(), mDone.end(),
+                            conflict.begin() + k * mWords);
+                    done = true;
+                } else {
+                    if (mOrdering == Ordering::dynamic)
+                        mOrder[k] = choose();
+                    // First guess: mine
+                    stage[k] = 1;
+                    const int v = mOrder[k];
+                    if (assign(v, true)) {
+                        stage[++k] = 0;
+                        continue;
+                    }
+                    if (mLearn)
+                        explain(v, why.data());
+                    unassign(v);
+                    if (refute(k, v, why.data()))
+                        stage[k] = 2;
+                }
+            }
+            if (!done && stage[k] == 1) {
+                // Second guess: not a mine
+                stage[k] = 2;
+                const int v = mOrder[k];
+                if (assign(v, false)) {
+                    stage[++k] = 0;
+                    continue;
+                }
+                if (mLearn)
+                    explain(v, why.data());
+                unassign(v);
+                refute(k, v, why.data());
+            }
+            if (!done) {
+                if (mLearn && !solved[k])
+                    add_nogood(conflict.data() + k * mWords);
+                cache.insert(key(), rem, here);
+            }
+            if (k == 0) {
+                out.assign(here, here + size);
+                return true;
+            }
+            // Back to the parent, which resumes at its next guess, unless
+            // the reason this state failed leaves out the parent's block
+            k--;
+            const int v = mOrder[k];
+            merge(counts.data() + offset[k], here, rem, stage[k] == 1,
+                rank(v));
+            if (solved[k + 1])
+                solved[k] = true;
+            else if (refute(k, v, conflict.data() + (k + 1) * mWords)
+                && stage[k] == 1)
+                stage[k] = 2;
+            unassign(v);
+        }
+    }
+} // namespace Holy
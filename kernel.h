@@ -0,0 +1,176 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "solvers.h"
+#include <memory_resource>
+
+/// @file kernel.h The search kernel behind john()
+/// A frontier component is compiled into a compact structure of variables
+/// (its unknown blocks) and constraints (the numbers around them), so the
+/// search works on a few small arrays instead of the whole GameData.
+
+namespace Holy {
+    /// @brief The order in which FrontKernel::count() assigns blocks
+    enum class Ordering {
+        /// The order of the component, x then y
+        scan,
+        /// Breadth first from the first block, through shared numbers
+        bfs,
+        /// The blocks next to the most numbers first, then as scan
+        constrained,
+        /// At every state, the first unassigned block of the tightest
+        /// number, preferring numbers the search has reached: the fewest
+        /// mines or safe blocks left to place, then the fewest blocks left
+        dynamic
+    };
+
+    /// @brief The ordering john() uses
+    constexpr Ordering john_ordering = Ordering::dynamic;
+
+    /// @returns the name of o, as in its declaration
+    const char* name(Ordering o) noexcept;
+
+    /// @brief Most blocks in a nogood FrontKernel learns, longer ones are
+    /// too specific to come up again
+    constexpr int nogood_max_size = 16;
+
+    /// @brief Most nogoods a FrontKernel learns
+    constexpr int nogood_max = 1 << 12;
+
+    /// @brief The components of the frontier of game as john() searches
+    /// them: two unknown blocks next to numbers with mines left are in the
+    /// same one if a chain of shared numbers links them. Each is in x then
+    /// y order.
+    std::pmr::vector<Frontier> front_components(
+        const GameData& game,
+        std::pmr::memory_resource* res = std::pmr::get_default_resource());
+
+    /// @brief One frontier component, compiled for counting its solutions
+    class FrontKernel {
+    public:
+        /// @brief Compiles comp, a component of the frontier of game
+        /// Only reads game, which may change afterwards.
+        /// @param res -- where the kernel and its searches allocate
+        /// @param order -- the order count() assigns blocks in
+        FrontKernel(
+            const GameData& game,
+            const Frontier& comp,
+            std::pmr::memory_resource* res = std::pmr::get_default_resource(),
+            Ordering order = john_ordering);
+
+        /// @brief Counts the solutions of the component by number of mines
+        ///
+        /// The search is an explicit-stack DFS over the blocks in the
+        /// kernel's ordering, checking the numbers with popcounts over the
+        /// bitmasks of the partial assignment. Every state is looked up in
+        /// cache before it is searched and stored in it afterwards. The
+        /// counts of a state list its unassigned blocks in the order of
+        /// comp whatever the ordering, so states reached in different
+        /// orders, or by kernels of different orderings, share entries.
+        ///
+        /// Once learn() turns it on, a state without solutions is explained
+        /// by the blocks whose values rule it out. If the explanation of
+        /// its first branch does not involve the block it branches on, the
+        /// second branch fails for the same reason and is skipped, so the
+        /// search jumps back to the block responsible. The explanation is
+        /// also learned as a nogood, which rules out those values wherever
+        /// they recur, if it has at most nogood_max_size blocks.
+        /// @param cache -- counts of earlier searches
+        /// @param node_cap -- states that may be searched before giving up
+        /// @param out -- receives the counts, blocks in the order of comp,
+        /// laid out as in JohnCache::Entry: ways then mined
+        /// @returns false if node_cap was reached, out is then unspecified
+        /// @exception This function only transmits exceptions.
+        bool count(
+            JohnCache& cache,
+            long long node_cap,
+            std::pmr::vector<double>& out);
+
+        /// @returns the key of the current state, that of the whole
+        /// component outside of count(); equal keys have equal counts (see
+        /// JohnCache)
+        std::uint64_t key() const noexcept;
+
+        /// @returns the number of states searched by count()
+        long long nodes() const noexcept;
+
+        /// @brief Turns backjumping and nogoods on or off, they are off
+        /// unless turned on
+        /// Under Ordering::dynamic, which john() uses, the tightest number
+        /// is branched on first, so conflicts show up early and nogoods
+        /// save few states. The fixed orderings gain more from them.
+        void learn(bool on) noexcept;
+
+        /// @returns the number of nogoods learned
+        int nogoods() const noexcept;
+
+    private:
+        // Assigns a value to block v and updates the numbers around it
+        // Returns whether the numbers can still be satisfied
+        bool assign(int v, bool mine) noexcept;
+
+        // Reverts assign(v, ...)
+        void unassign(int v) noexcept;
+
+        // Recomputes the key of constraint c after a change
+        // Returns whether c can still be satisfied
+        bool update(int c) noexcept;
+
+        // The block to assign next under Ordering::dynamic
+        int choose() const noexcept;
+
+        // Sets out to the blocks whose values make the last assign(v, ...)
+        // fail, v among them: the mines or safe blocks of a number that
+        // has too many of them, or the blocks of a nogood
+        void explain(int v, std::uint64_t* out) const noexcept;
+
+        // Learns that the blocks in mask cannot all keep their values
+        void add_nogood(const std::uint64_t* mask);
+
+        // Unassigned blocks before block v in the order of comp
+        int rank(int v) const noexcept;
+
+        // Number of blocks and of 64-bit words in a mask over them
+        int mN = 0, mWords = 0;
+
+        // The constraints: position, elabel and vacant_nei before the search
+        std::pmr::vector<Point> mPos;
+        std::pmr::vector<int> mLabel, mVacant;
+        // CSR: constraint c covers the (word, mask) pairs
+        // mMasks[mMaskStart[c] .. mMaskStart[c + 1])
+        std::pmr::vector<int> mMaskStart;
+        std::pmr::vector<std::pair<int, std::uint64_t>> mMasks;
+        // CSR: block v is covered by constraints
+        // mVarCons[mVarStart[v] .. mVarStart[v + 1])
+        std::pmr::vector<int> mVarStart, mVarCons;
+
+        // The partial assignment: mined blocks and assigned blocks
+        std::pmr::vector<std::uint64_t> mMine, mDone;
+
+        // Current sig_key() of each constraint and their XOR
+        std::pmr::vector<std::uint64_t> mConsKey;
+        std::uint64_t mSig = 0;
+        // Current elabel and vacant_nei of each constraint
+        std::pmr::vector<int> mCurLabel, mCurVacant;
+        // cell_key() of each block, and their XOR over unassigned blocks
+        std::pmr::vector<std::uint64_t> mCellKey;
+        std::uint64_t mFree = 0;
+
+        Ordering mOrdering;
+        // The block assigned at each depth, fixed in advance unless the
+        // ordering is dynamic
+        std::pmr::vector<int> mOrder;
+
+        long long mNodes = 0;
+
+        bool mLearn = false;
+        // CSR: nogood g is over the blocks
+        // mGoodVars[mGoodStart[g] .. mGoodStart[g + 1]), with their values
+        // at the time it was learned, of which mGoodHits[g] hold now
+        std::pmr::vector<int> mGoodStart, mGoodVars, mGoodHits;
+        // mWatch[2 * v + mine]: the nogoods in which block v has that value
+        std::pmr::vector<std::pmr::vector<int>> mWatch;
+    };
+} // namespace Holy
+
+#endif // KERNEL_H
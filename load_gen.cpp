@@ -0,0 +1,127 @@
+// Contains main()
+// Puts solve_daemon under load and measures how it copes
+// Usage: load_gen <socket> [clients] [requests] [depth]
+//     clients  -- connections sending at the same time, 8 by default
+//     requests -- requests per client, 2000 by default
+//     depth    -- requests a client keeps unanswered, 4 by default
+// The positions sent are the ones a player meets in Butterfly games, each
+// time the solvers get stuck and a guess has to be made.
+#include "analysis.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace Holy;
+using Clock = std::chrono::steady_clock;
+
+int connect_to(const char* path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path, sizeof addr.sun_path - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0
+        || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) {
+        std::cerr << "Cannot connect to " << path << '\n';
+        std::exit(1);
+    }
+    return fd;
+}
+
+// What a client saw
+struct Result {
+    // Latency of each request, in ns
+    std::vector<long long> latency;
+    // Answers by query::Status
+    long long status[3] = {};
+};
+
+// Sends requests positions starting from first, keeping depth of them
+// unanswered
+void client(const char* path, const std::vector<query::Request>& positions,
+    std::size_t first, int requests, int depth, Result& result) {
+    const int fd = connect_to(path);
+    std::vector<Clock::time_point> sent(requests);
+    std::vector<query::Cell> cells(query::max_cells);
+    result.latency.resize(requests);
+    int next = 0;
+    auto send_next = [&] {
+        query::Request request = positions[(first + next) % positions.size()];
+        request.id = next;
+        sent[next++] = Clock::now();
+        if (!query::send(fd, request)) {
+            std::cerr << "Lost the daemon\n";
+            std::exit(1);
+        }
+    };
+    while (next < std::min(depth, requests))
+        send_next();
+    for (int done = 0; done < requests; done++) {
+        query::Answer answer;
+        if (!query::receive(fd, answer, cells.data()) || answer.id >= sent.size()
+            || answer.status > query::inconsistent) {
+            std::cerr << "Lost the daemon\n";
+            std::exit(1);
+        }
+        result.latency[answer.id] =
+            (Clock::now() - sent[answer.id]) / std::chrono::nanoseconds(1);
+        result.status[answer.status]++;
+        if (next < requests)
+            send_next();
+    }
+    ::close(fd);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: load_gen <socket> [clients] [requests] [depth]\n";
+        return 1;
+    }
+    const int clients = argc > 2 ? std::atoi(argv[2]) : 8;
+    const int requests = argc > 3 ? std::atoi(argv[3]) : 2000;
+    const int depth = argc > 4 ? std::atoi(argv[4]) : 4;
+    if (clients < 1 || requests < 1 || depth < 1) {
+        std::cerr << "clients, requests and depth should be positive\n";
+        return 1;
+    }
+    const auto positions = collect_positions(1000);
+    std::vector<Result> results(clients);
+    std::vector<std::thread> threads;
+    const auto start = Clock::now();
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back(client, argv[1], std::cref(positions),
+            c * positions.size() / clients, requests, depth,
+            std::ref(results[c]));
+    }
+    for (auto& t : threads)
+        t.join();
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    std::vector<long long> latency;
+    long long status[3] = {};
+    for (const auto& r : results) {
+        latency.insert(latency.end(), r.latency.begin(), r.latency.end());
+        for (int s = 0; s < 3; s++)
+            status[s] += r.status[s];
+    }
+    std::sort(latency.begin(), latency.end());
+    auto quantile = [&](double q) {
+        return latency[std::min(latency.size() - 1,
+                   (std::size_t)(q * latency.size()))]
+            / 1000;
+    };
+    std::cout << "Requests: " << latency.size() << " from " << clients
+              << " clients, " << depth << " in flight each\n";
+    std::cout << "Answers ok: " << status[query::ok]
+              << "    malformed: " << status[query::malformed]
+              << "    inconsistent: " << status[query::inconsistent] << '\n';
+    std::cout << "Throughput: " << latency.size() / seconds << " requests/s\n";
+    std::cout << "Latency p50: " << quantile(0.5) << "us    p99: "
+              << quantile(0.99) << "us    max: " << latency.back() / 1000
+              << "us\n";
+}
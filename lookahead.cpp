@@ -0,0 +1,197 @@
+#include "lookahead.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    using namespace Holy;
+    using Clock = std::chrono::steady_clock;
+
+    // Unknown blocks left on the board
+    int count_unknown(const GameData& game) noexcept {
+        int ret = 0;
+        for (const auto& block : game.blocks)
+            ret += block.status == Block::unknown;
+        return ret;
+    }
+
+    // Whether the unknown block at p borders a number
+    bool on_frontier(const GameData& game, Point p) noexcept {
+        bool found = false;
+        game.for_each_nei8(p, [&](Point np) {
+            found = found || game[np].status == Block::number;
+        });
+        return found;
+    }
+
+    // Chance that each block is a mine, frontier from mc, the rest from
+    // the mines left for them
+    std::array<double, hash_max>
+        chances(const GameData& game, const MineChance& mc) {
+        std::array<double, hash_max> ret{};
+        double front_mines = 0;
+        int inner = 0;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status != Block::unknown)
+                    continue;
+                if (on_frontier(game, p)) {
+                    ret[p.hash()] = (double)mc[p.hash()] / chance_scale;
+                    front_mines += ret[p.hash()];
+                } else {
+                    inner++;
+                }
+            }
+        }
+        const double density = inner == 0
+            ? 0
+            : std::clamp((game.mines_left - front_mines) / inner, 0.0, 1.0);
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status == Block::unknown && !on_frontier(game, p))
+                    ret[p.hash()] = density;
+            }
+        }
+        return ret;
+    }
+
+    // Blocks the deterministic solvers resolve on game, which is left
+    // where they stop
+    int settle(GameData& game) {
+        const int before = count_unknown(game);
+        while (roundup(game) || window(game) || felix(game)) {}
+        return before - count_unknown(game);
+    }
+
+    // Plays out each likely label of the guess at g on game, rolling fork
+    // back after each
+    void evaluate(
+        GameData& game,
+        GameData::Fork& fork,
+        const std::array<double, hash_max>& chance,
+        double min_label_chance,
+        GuessScore& g) {
+        // dist[l]: chance the label is l, neighbors being independent
+        double dist[9] = { 1 };
+        int known = 0;
+        game.for_each_nei8(g.p, [&](Point np) {
+            if (game[np].status == Block::mine) {
+                known++;
+            } else if (game[np].status == Block::unknown) {
+                const double c = chance[np.hash()];
+                for (int l = 8; l >= 0; l--)
+                    dist[l] = dist[l] * (1 - c) + (l ? dist[l - 1] * c : 0);
+            }
+        });
+        double weight = 0, solved = 0, moved = 0;
+        for (int l = 0; l + known <= 8; l++) {
+            if (dist[l] <= 0 || dist[l] < min_label_chance)
+                continue;
+            game.mark_semiknown(g.p);
+            game.reveal(g.p, l + known);
+            int resolved = 0;
+            bool fits = true;
+            try {
+                resolved = settle(game);
+            } catch (const std::runtime_error&) {
+                // The label cannot be, a mark ran into it
+                fits = false;
+            }
+            fork.rollback();
+            if (!fits)
+                continue;
+            weight += dist[l];
+            solved += dist[l] * resolved;
+            moved += resolved > 0 ? dist[l] : 0;
+        }
+        g.expected = weight > 0 ? g.safe * solved / weight : 0;
+        g.progress = weight > 0 ? g.safe * moved / weight : 0;
+        g.evaluated = true;
+    }
+} // namespace
+
+namespace Holy {
+    std::vector<GuessScore> evaluate_guesses(
+        const GameData& game,
+        const MineChance& mc,
+        const LookaheadConfig& config) {
+        const auto deadline = Clock::now() + config.budget;
+        const auto chance = chances(game, mc);
+        std::vector<GuessScore> scores;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status == Block::unknown)
+                    scores.push_back({ p, 1 - chance[p.hash()] });
+            }
+        }
+        std::stable_sort(scores.begin(), scores.end(), [](auto& a, auto& b) {
+            return a.safe > b.safe;
+        });
+        if ((int)scores.size() > config.candidates)
+            scores.resize(std::max(config.candidates, 0));
+        int threads = config.threads;
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min<int>(threads, scores.size());
+        // Each worker forks its own copy, candidates are taken in order
+        std::atomic<int> next{ 0 };
+        // The first exception of any worker, or of starting one, rethrown
+        // once all of them are joined; the others then take no more
+        // candidates
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        const auto fail = [&] {
+            std::lock_guard lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+            next = scores.size();
+        };
+        const auto worker = [&] {
+            try {
+                GameData board = game;
+                GameData::Fork fork(board);
+                for (int i; (i = next++) < (int)scores.size();) {
+                    if (Clock::now() >= deadline)
+                        return;
+                    evaluate(board, fork, chance, config.min_label_chance,
+                        scores[i]);
+                }
+            } catch (...) {
+                fail();
+            }
+        };
+        std::vector<std::thread> pool;
+        try {
+            for (int t = 1; t < threads; t++)
+                pool.emplace_back(worker);
+        } catch (...) {
+            fail();
+        }
+        if (threads > 0)
+            worker();
+        for (auto& th : pool)
+            th.join();
+        if (error)
+            std::rethrow_exception(error);
+        double safest = 0;
+        for (const auto& g : scores)
+            safest = std::max(safest, g.evaluated ? g.safe : 0);
+        // Rank within the tolerance by progress, the rest by safety
+        const auto key = [&](const GuessScore& g) {
+            return g.safe >= safest - config.tolerance ? 1 + g.progress
+                                                       : g.safe;
+        };
+        std::stable_sort(scores.begin(), scores.end(), [&](auto& a, auto& b) {
+            if (a.evaluated != b.evaluated)
+                return a.evaluated;
+            return key(a) > key(b);
+        });
+        return scores;
+    }
+} // namespace Holy
@@ -0,0 +1,63 @@
+#ifndef LOOKAHEAD_H
+#define LOOKAHEAD_H
+
+#include "solvers.h"
+#include <chrono>
+
+/// @file lookahead.h Choosing among guesses by what they lead to
+/// When john() advises a guess, the blocks least likely to be mines are
+/// tried on forks of the board (see GameData::Fork): each likely label is
+/// revealed in turn, and the deterministic solvers are run to see how far
+/// the board opens up.
+
+namespace Holy {
+    /// @brief Parameters of evaluate_guesses()
+    struct LookaheadConfig {
+        /// Blocks to evaluate, the least likely mines first
+        int candidates = 8;
+        /// Worker threads, each with a copy of the board to fork.
+        /// 0 means one per hardware thread.
+        int threads = 0;
+        /// Wall clock limit, candidates not reached by then are left
+        /// unevaluated
+        std::chrono::milliseconds budget{ 50 };
+        /// Labels less likely than this are not tried
+        double min_label_chance = 0.01;
+        /// Candidates at most this much less safe than the safest are
+        /// ranked by progress, the rest by safety
+        double tolerance = 0.01;
+    };
+
+    /// @brief What a guess is expected to do
+    struct GuessScore {
+        Point p;
+        /// Chance that p is not a mine
+        double safe = 0;
+        /// Expected blocks the deterministic solvers resolve after
+        /// revealing p, times safe
+        double expected = 0;
+        /// Chance that p is safe and the solvers move after revealing it
+        double progress = 0;
+        /// Whether the budget allowed to compute expected
+        bool evaluated = false;
+    };
+
+    /// @brief Scores the candidate guesses on game
+    ///
+    /// The chance of a block off the frontier is taken to be the density of
+    /// the mines john() leaves for them. The label a guess reveals is
+    /// distributed as if its neighbors were mines independently, with
+    /// their chances in mc.
+    /// @param mc -- the chances john() returned for game
+    /// @returns the candidates, evaluated ones first, best first: among
+    /// those within config.tolerance of the safest the most likely to make
+    /// progress, then the safest
+    /// @exception This function only transmits exceptions, those of the
+    /// worker threads once all of them are joined.
+    std::vector<GuessScore> evaluate_guesses(
+        const GameData& game,
+        const MineChance& mc,
+        const LookaheadConfig& config = {});
+} // namespace Holy
+
+#endif // LOOKAHEAD_H
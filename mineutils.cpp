@@ -1,23 +1,60 @@
 #include "mineutils.h"
 
 namespace Holy {
-    void GameData::recount() noexcept {
-        for (int ix = 1; ix <= col; ix++) {
-            for (int iy = 1; iy <= row; iy++) {
+    GameData::GameData() noexcept {
+        for (int ix = 0; ix <= col + 1; ix++) {
+            blocks[Point{ ix, 0 }.index()].status = Block::border;
+            blocks[Point{ ix, row + 1 }.index()].status = Block::border;
+        }
+        for (int iy = 0; iy <= row + 1; iy++) {
+            blocks[Point{ 0, iy }.index()].status = Block::border;
+            blocks[Point{ col + 1, iy }.index()].status = Block::border;
+        }
+    }
+
+    GameData::GameData(const GameData& src) noexcept :
+        blocks(src.blocks), mines_left(src.mines_left),
+        signature(src.signature) {}
+
+    GameData& GameData::operator=(const GameData& src) noexcept {
+        blocks = src.blocks;
+        mines_left = src.mines_left;
+        signature = src.signature;
+        return *this;
+    }
+
+    GameData::Fork::Fork(GameData& base) :
+        mBase(base), mOuter(base.mFork), mMinesLeft(base.mines_left),
+        mSignature(base.signature) {
+        base.mFork = this;
+    }
+
+    GameData::Fork::~Fork() noexcept {
+        rollback();
+        mBase.mFork = mOuter;
+    }
+
+    void GameData::Fork::rollback() noexcept {
+        for (auto it = mLog.rbegin(); it != mLog.rend(); ++it)
+            mBase.blocks[it->first] = it->second;
+        mLog.clear();
+        mBase.mines_left = mMinesLeft;
+        mBase.signature = mSignature;
+    }
+
+    int GameData::Fork::changes() const noexcept {
+        return mLog.size();
+    }
+
+    void GameData::recount() {
+        signature = 0;
+        for (int iy = 1; iy <= row; iy++) {
+            for (int ix = 1; ix <= col; ix++) {
+                const int i = Point{ ix, iy }.index();
                 // only number blocks have second data
-                auto& iblock = blocks[ix][iy];
-                if (iblock.status != Block::number)
+                if (blocks[i].status != Block::number)
                     continue;
-                iblock.second_init = true;
-                iblock.elabel = iblock.label;
-                iblock.vacant_nei = 0;
-                Point{ ix, iy }.for_each_nei8([&, this](Point np) {
-                    auto& nblock = blocks[np.x][np.y];
-                    if (nblock.status == Block::mine)
-                        iblock.elabel--;
-                    if (nblock.status == Block::unknown)
-                        iblock.vacant_nei++;
-                });
+                recount_at(i);
             }
         }
     }
@@ -26,19 +63,45 @@ namespace Holy {
         // Don't call this in recount() because of this if clause
         if (!p.valid())
             throw std::out_of_range("p is not valid!");
-        auto& block = blocks[p.x][p.y];
-        if (block.status != Block::number)
+        const int i = p.index();
+        if (blocks[i].status != Block::number)
             return;
+        if (blocks[i].second_init)
+            signature ^= sig_key(i, blocks[i].elabel, blocks[i].vacant_nei);
+        recount_at(i);
+    }
+
+    void GameData::recount_at(int i) {
+        log(i);
+        auto& block = blocks[i];
         block.second_init = true;
-        block.elabel = block.label;
-        block.vacant_nei = 0;
-        p.for_each_nei8([&, this](Point np) {
-            auto& nblock = blocks[np.x][np.y];
-            if (nblock.status == Block::mine)
-                block.elabel--;
-            if (nblock.status == Block::unknown)
-                block.vacant_nei++;
-        });
+        int elabel = block.label, vacant = 0;
+        // The sentinel ring is neither mine nor unknown
+        for (int off : nei8_offset) {
+            const auto status = blocks[i + off].status;
+            elabel -= status == Block::mine;
+            vacant += status == Block::unknown;
+        }
+        block.elabel = elabel;
+        block.vacant_nei = vacant;
+        signature ^= sig_key(i, elabel, vacant);
+    }
+
+    void GameData::adjust(int i, int delabel, int dvacant) {
+        log(i);
+        Block& block = blocks[i];
+        signature ^= sig_key(i, block.elabel, block.vacant_nei);
+        block.elabel += delabel;
+        block.vacant_nei += dvacant;
+        signature ^= sig_key(i, block.elabel, block.vacant_nei);
+    }
+
+    void GameData::adjust_nei8(int i, int delabel, int dvacant) {
+        // second_init is never set on the sentinel ring
+        for (int off : nei8_offset) {
+            if (blocks[i + off].second_init)
+                adjust(i + off, delabel, dvacant);
+        }
     }
 
     void GameData::mark_semiknown(Point p) {
@@ -48,13 +111,11 @@ namespace Holy {
             throw std::runtime_error(
                 "mark_semiknown: p does not refer to an unprobed block!");
         // Mark point p
+        log(p.index());
         (*this)[p].status = Block::semiknown;
         // mark neighbors, to keep invariant, only take action if second_init is
         // true if second_init is false, this will be taken care of in recount()
-        p.for_each_nei8([this](Point np) {
-            if ((*this)[np].second_init)
-                (*this)[np].vacant_nei--;
-        });
+        adjust_nei8(p.index(), 0, -1);
     }
 
     bool GameData::mark_semiknown_check(Point p) {
@@ -65,19 +126,20 @@ namespace Holy {
                 "mark_semiknown_check: p does not refer to an unprobed block!");
         // Grab a list of the blocks to be touched (max size = 8)
         // starts from 1
-        Point nps[10] = {};
+        int nps[10] = {};
         // how many entries are there in nps
         int cnt = 0;
-        p.for_each_nei8([&](Point np) {
-            if ((*this)[np].second_init)
-                nps[++cnt] = np;
-        });
+        for (int off : nei8_offset) {
+            if (blocks[p.index() + off].second_init)
+                nps[++cnt] = p.index() + off;
+        }
+        log(p.index());
         (*this)[p].status = Block::semiknown;
         // The current neighbor under manipulation
         int curr = 1;
         for (; curr <= cnt; curr++) {
-            Block& nei = (*this)[nps[curr]];
-            nei.vacant_nei--;
+            adjust(nps[curr], 0, -1);
+            const Block& nei = blocks[nps[curr]];
             if (nei.vacant_nei < nei.elabel)
                 break;
         }
@@ -87,7 +149,8 @@ namespace Holy {
         else {
             // Revert the changes we made
             for (; curr >= 1; curr--)
-                (*this)[nps[curr]].vacant_nei++;
+                adjust(nps[curr], 0, 1);
+            log(p.index());
             (*this)[p].status = Block::unknown;
             return false;
         }
@@ -100,13 +163,9 @@ namespace Holy {
             throw std::runtime_error(
                 "mark_mine: p does not refer to an unprobed block!");
         // Mark point p
+        log(p.index());
         (*this)[p].status = Block::mine;
-        p.for_each_nei8([this](Point np) {
-            if ((*this)[np].second_init) {
-                (*this)[np].vacant_nei--;
-                (*this)[np].elabel--;
-            }
-        });
+        adjust_nei8(p.index(), -1, -1);
         // Decrease the number of mines left
         mines_left--;
     }
@@ -121,22 +180,21 @@ namespace Holy {
         if (mines_left <= 0)
             return false;
         // Grab the list of neighbors that have had second init
-        Point nps[10] = {};
+        int nps[10] = {};
         int cnt = 0;
-        p.for_each_nei8([&](Point np) {
-            if ((*this)[np].second_init)
-                nps[++cnt] = np;
-        });
+        for (int off : nei8_offset) {
+            if (blocks[p.index() + off].second_init)
+                nps[++cnt] = p.index() + off;
+        }
         // make the mark
+        log(p.index());
         (*this)[p].status = Block::mine;
         // Start modifying second_init data
         int curr = 1;
         for (; curr <= cnt; curr++) {
-            Block& nei = (*this)[nps[curr]];
-            nei.elabel--;
-            nei.vacant_nei--;
+            adjust(nps[curr], -1, -1);
             // elabel <= vacant_nei because they both decreased
-            if (nei.elabel < 0)
+            if (blocks[nps[curr]].elabel < 0)
                 break;
         }
         if (curr == cnt + 1) {
@@ -145,28 +203,81 @@ namespace Holy {
             return true;
         } else {
             // Revert
-            for (; curr >= 1; curr--) {
-                Block& nei = (*this)[nps[curr]];
-                nei.elabel++;
-                nei.vacant_nei++;
-            }
+            for (; curr >= 1; curr--)
+                adjust(nps[curr], 1, 1);
+            log(p.index());
             (*this)[p].status = Block::unknown;
             return false;
         }
     }
 
+    bool GameData::mark_batch_check(const Mark* marks, int n) {
+        // Changes to elabel and vacant_nei of the numbers around the marks,
+        // and whether each block is marked. A touched number always has
+        // vacant < 0, which tells the first touch.
+        struct Delta {
+            std::int8_t elabel = 0, vacant = 0;
+            bool marked = false;
+        };
+        std::array<Delta, board_size> delta;
+        std::array<int, board_size> touched;
+        int cnt = 0, mined = 0;
+        for (int k = 0; k < n; k++) {
+            const Point p = marks[k].p;
+            if (!p.valid())
+                throw std::runtime_error("p is not valid!");
+            const int i = p.index();
+            if (blocks[i].status != Block::unknown || delta[i].marked)
+                throw std::runtime_error(
+                    "mark_batch: p does not refer to an unprobed block!");
+            delta[i].marked = true;
+            mined += marks[k].mine;
+            for (int off : nei8_offset) {
+                if (!blocks[i + off].second_init)
+                    continue;
+                Delta& d = delta[i + off];
+                if (d.vacant == 0)
+                    touched[cnt++] = i + off;
+                d.elabel -= marks[k].mine;
+                d.vacant--;
+            }
+        }
+        if (mined > mines_left)
+            return false;
+        for (int t = 0; t < cnt; t++) {
+            const Block& b = blocks[touched[t]];
+            const Delta& d = delta[touched[t]];
+            const int elabel = b.elabel + d.elabel;
+            if (elabel < 0 || b.vacant_nei + d.vacant < elabel)
+                return false;
+        }
+        // All checked, nothing below fails
+        for (int k = 0; k < n; k++) {
+            const int i = marks[k].p.index();
+            log(i);
+            blocks[i].status = marks[k].mine ? Block::mine : Block::semiknown;
+        }
+        for (int t = 0; t < cnt; t++) {
+            const Delta& d = delta[touched[t]];
+            adjust(touched[t], d.elabel, d.vacant);
+        }
+        mines_left -= mined;
+        return true;
+    }
+
+    void GameData::mark_batch(const Mark* marks, int n) {
+        if (!mark_batch_check(marks, n))
+            throw std::runtime_error("mark_batch: the marks break a number!");
+    }
+
     void GameData::unmark_mine(Point p) {
         if (!p.valid())
             throw std::runtime_error("p is not valid!");
         if ((*this)[p].status != Block::mine)
             throw std::runtime_error("Attempting to unmark a non-mine block");
+        log(p.index());
         (*this)[p].status = Block::unknown;
-        p.for_each_nei8([this](Point np) {
-            if ((*this)[np].second_init) {
-                (*this)[np].vacant_nei++;
-                (*this)[np].elabel++;
-            }
-        });
+        adjust_nei8(p.index(), 1, 1);
         mines_left++;
     }
 
@@ -176,11 +287,19 @@ namespace Holy {
         if ((*this)[p].status != Block::semiknown)
             throw std::runtime_error(
                 "The block about to be unmarked is not marked");
+        log(p.index());
         (*this)[p].status = Block::unknown;
-        p.for_each_nei8([this](Point np) {
-            Block& nb = (*this)[np];
-            if (nb.second_init)
-                nb.vacant_nei++;
-        });
+        adjust_nei8(p.index(), 0, 1);
+    }
+
+    void GameData::reveal(Point p, int label) {
+        if (!p.valid())
+            throw std::runtime_error("p is not valid!");
+        if ((*this)[p].status != Block::semiknown)
+            throw std::runtime_error("reveal: p is not a semiknown block!");
+        log(p.index());
+        (*this)[p].status = Block::number;
+        (*this)[p].label = label;
+        recount(p);
     }
 } // namespace Holy
\ No newline at end of file
@@ -3,12 +3,25 @@
 
 #include <array>
 #include <bitset>
+#include <cstdint>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace Holy {
     // parameters of minesweeper game
     constexpr int col = 30, row = 16, mines = 99, hash_max = 512;
 
+    // GameData lays out the board row by row, with a ring of sentinel blocks
+    // around it so that every block on the board has all 8 neighbors in
+    // memory. stride is the length of a row, board_size the number of blocks
+    constexpr int stride = col + 2, board_size = stride * (row + 2);
+
+    // Offsets of the 8 neighbors in that layout, in the same order as
+    // Point::for_each_nei8
+    constexpr std::array<int, 8> nei8_offset = { -stride - 1, -stride,
+        -stride + 1, -1, 1, stride - 1, stride, stride + 1 };
+
     // structure of a point (simple aggregate)
     struct Point {
         int x, y;
@@ -23,6 +36,11 @@ namespace Holy {
             return x + y * col;
         }
 
+        // Returns the index of *this in the layout of GameData
+        constexpr int index() const noexcept {
+            return y * stride + x;
+        }
+
         // Carry out an operation for the valid of 8 neighbors of p
         // fn(Point) should be a valid invocation
         template <typename Fn>
@@ -90,48 +108,151 @@ namespace Holy {
     // The bitset used as a checklist
     using Checklist = std::bitset<hash_max>;
 
+    // Scrambles x into a pseudo random 64-bit value (splitmix64 finalizer)
+    // Used to make Zobrist-style keys without storing a table
+    constexpr std::uint64_t mix64(std::uint64_t x) noexcept {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    // Key of a number block at index i in the signature of GameData
+    constexpr std::uint64_t sig_key(int i, int elabel, int vacant) noexcept {
+        return mix64(
+            (std::uint64_t)i << 16 | (std::uint64_t)(elabel & 0xff) << 8
+            | (std::uint64_t)(vacant & 0xff));
+    }
+
+    // Key of an unknown block at p, to tell apart sets of blocks
+    inline std::uint64_t cell_key(Point p) noexcept {
+        return mix64((std::uint64_t)p.hash() | 1ULL << 40);
+    }
+
     // Data structure of a block
-    // This struct stores the basic data of a block
+    // This struct stores the basic data of a block, a byte per field
     struct Block {
         // status of block
         // semiknown is a state where you know a block contains a number,
         // but do not know what the number is exactly.
-        enum Status { unknown, mine, number, semiknown };
+        // border is only found in the sentinel ring around the board.
+        enum Status : std::uint8_t { unknown, mine, number, semiknown, border };
         Status status = unknown;
         // label read from mock-server (0 if status != number)
-        int label = 0;
+        std::int8_t label = 0;
         // tags whether second hand data is initialized
         // FIXME: Perhaps put second_init into private and befriend
         // GameData::recount() -- difficult
         // Or put this info into GameData
         bool second_init = false;
         // effective label (0 if status != number)
-        int elabel = 0;
+        std::int8_t elabel = 0;
         // the number of vacant neighbors
-        int vacant_nei = 0;
+        std::int8_t vacant_nei = 0;
+    };
+
+    static_assert(sizeof(Block) == 5, "A row of blocks should stay compact");
+
+    // A mark made by GameData::mark_batch(): p becomes a mine if mine is
+    // true, semiknown otherwise
+    struct Mark {
+        Point p;
+        bool mine;
     };
 
     // This class stores the basic data of the game
     struct GameData {
-        // Array of the blocks
-        std::array<std::array<Block, row + 1>, col + 1> blocks;
+        // Array of the blocks, in the layout described at stride
+        std::array<Block, board_size> blocks;
 
         // Mines left
         int mines_left = mines;
 
+        // XOR of sig_key() over the number blocks with second_init, so equal
+        // signatures mean equal constraints on the unknown blocks.
+        // Kept up to date by the member functions below.
+        std::uint64_t signature = 0;
+
+        // Every block on the board is unknown, the ring around it is border
+        GameData() noexcept;
+
+        // Copies the board of src, but not its forks
+        GameData(const GameData& src) noexcept;
+
+        // Copies the board of src, but not its forks
+        // Not logged by a Fork of *this
+        GameData& operator=(const GameData& src) noexcept;
+
+        // A branch of the board that can be rolled back
+        // While a Fork is alive, the member functions below log every block
+        // they change before changing it, so the branch costs only its
+        // changes instead of a copy of the board. Rolling back restores the
+        // logged blocks, mines_left and signature.
+        // Forks nest: the newest one alive does the logging, and should be
+        // the first to go. Blocks written to directly are not logged.
+        // The log grows as needed, so the functions that log may throw
+        // std::bad_alloc.
+        class Fork {
+        public:
+            explicit Fork(GameData& base);
+
+            // Copy operations are not permitted.
+            Fork(const Fork& src) = delete;
+
+            // Copy operations are not permitted.
+            Fork& operator=(const Fork& src) = delete;
+
+            // Rolls back and stops logging
+            ~Fork() noexcept;
+
+            // Undoes the changes made since the fork, or since the last
+            // rollback(), and keeps logging
+            void rollback() noexcept;
+
+            // Number of block changes logged since then
+            int changes() const noexcept;
+
+        private:
+            friend struct GameData;
+
+            GameData& mBase;
+            Fork* mOuter;
+            std::vector<std::pair<int, Block>> mLog;
+            int mMinesLeft;
+            std::uint64_t mSignature;
+        };
+
         // A shorthand for accessing a given Block
         // Does not check for out_of_bound errors, to make noexcept promise
         // According to language standard, only one argument
         inline Block& operator[](Point p) noexcept {
-            return blocks[p.x][p.y];
+            return blocks[p.index()];
         }
 
         inline const Block& operator[](Point p) const noexcept {
-            return blocks[p.x][p.y];
+            return blocks[p.index()];
+        }
+
+        // Carry out an operation for the 8 neighbors of p that are on the
+        // board, like Point::for_each_nei8 but without bounds checks:
+        // a neighbor is skipped if it is a border block.
+        // fn(Point) should be a valid invocation
+        template <typename Fn>
+        void for_each_nei8(Point p, Fn&& fn) const {
+            static_assert(
+                std::is_invocable_v<Fn, Point>,
+                "Should meet type req!");
+            constexpr int dx[] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+            constexpr int dy[] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+            const Block* base = blocks.data() + p.index();
+            for (int i = 0; i < 8; i++) {
+                if (base[nei8_offset[i]].status != Block::border)
+                    fn(Point{ p.x + dx[i], p.y + dy[i] });
+            }
         }
 
         // (Re)initializes satellite data for number blocks
-        void recount() noexcept;
+        void recount();
 
         // Initializes satellite data for a specific block
         // throws out of range if p is not valid
@@ -159,11 +280,51 @@ namespace Holy {
         // Exception safety as described in mark_semiknown_check()
         bool mark_mine_check(Point p);
 
+        // Makes the n marks at once, as if by mark_mine() and
+        // mark_semiknown(), walking the neighbors of each block only once
+        // The marks are checked together before anything changes: every p
+        // should be an unprobed block on the board and appear once, or
+        // std::runtime_error is thrown. If the marks together break a rule
+        // (more mines than mines_left, a number with elabel < 0 or
+        // vacant_nei < elabel), returns false. Otherwise all of them are
+        // made and returns true. *this is unchanged unless true is returned.
+        bool mark_batch_check(const Mark* marks, int n);
+
+        // Like mark_batch_check(), but a broken rule throws
+        // std::runtime_error too
+        void mark_batch(const Mark* marks, int n);
+
         // Does the reverse of mark_semiknown
         void unmark_semiknown(Point p);
 
         // Reverse of mark_mine
         void unmark_mine(Point p);
+
+        // Turns the semiknown block p into a number with the given label,
+        // like a reveal read by accio(), and initializes its satellite data
+        // Throws std::runtime_error if p is not semiknown
+        void reveal(Point p, int label);
+
+        // Changes elabel and vacant_nei of the block at index i by the given
+        // amounts, keeping signature up to date
+        // Assumes that i is on the board and its second_init is true
+        void adjust(int i, int delabel, int dvacant);
+
+        // adjust() for every neighbor of index i that has second_init
+        void adjust_nei8(int i, int delabel, int dvacant);
+
+    private:
+        // Initializes satellite data for the number block at index i,
+        // whose old key is already out of signature
+        void recount_at(int i);
+
+        // Logs the block at index i to the newest fork, before a change
+        inline void log(int i) {
+            if (mFork)
+                mFork->mLog.emplace_back(i, blocks[i]);
+        }
+
+        Fork* mFork = nullptr;
     };
 } // namespace Holy
 
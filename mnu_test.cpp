@@ -1,5 +1,14 @@
+#include "kernel.h"
 #include "mineutils.h"
+#include "patterns.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 
 void CHECK(bool x, const char* msg = "ERROR") {
     if (!x) {
@@ -26,10 +35,434 @@ void nei4() {
     CHECK(a[{ 10, 10 }].label == 0, "10 10");
 }
 
+void border() {
+    std::cout << "\tEnter border testcase..." << std::endl;
+    using namespace Holy;
+    GameData a;
+    CHECK(a[{ 0, 0 }].status == Block::border, "0 0");
+    CHECK(a[{ 31, 17 }].status == Block::border, "31 17");
+    CHECK(a[{ 1, 1 }].status == Block::unknown, "1 1");
+    int cnt = 0;
+    a.for_each_nei8({ 1, 1 }, [&](Point np) { cnt += np.valid(); });
+    CHECK(cnt == 3, "corner");
+    cnt = 0;
+    a.for_each_nei8({ 30, 8 }, [&](Point np) { cnt += np.valid(); });
+    CHECK(cnt == 5, "edge");
+    // A mine in the corner, then a number next to it
+    a.mark_mine({ 1, 1 });
+    a[{ 2, 1 }].status = Block::number;
+    a[{ 2, 1 }].label = 1;
+    a.recount({ 2, 1 });
+    CHECK(a[{ 2, 1 }].elabel == 0, "elabel");
+    CHECK(a[{ 2, 1 }].vacant_nei == 4, "vacant_nei");
+}
+
+void batch() {
+    std::cout << "\tEnter batch testcase..." << std::endl;
+    using namespace Holy;
+    GameData a;
+    // A 1 in the corner, with three vacant neighbors
+    a[{ 1, 1 }].status = Block::number;
+    a[{ 1, 1 }].label = 1;
+    a.recount({ 1, 1 });
+    const GameData before = a;
+    // Two mines around a 1 are rejected as a whole
+    const Mark two[] = { { { 2, 1 }, true }, { { 1, 2 }, true } };
+    CHECK(!a.mark_batch_check(two, 2), "two mines");
+    CHECK(a.signature == before.signature && a.mines_left == mines,
+        "rejected");
+    CHECK(a[{ 2, 1 }].status == Block::unknown, "rejected status");
+    const Mark one[] = { { { 2, 1 }, true }, { { 1, 2 }, false },
+        { { 2, 2 }, false } };
+    CHECK(a.mark_batch_check(one, 3), "one mine");
+    CHECK(a[{ 1, 1 }].elabel == 0 && a[{ 1, 1 }].vacant_nei == 0, "counts");
+    CHECK(a.mines_left == mines - 1, "mines_left");
+    // The same as marking one by one
+    GameData b = before;
+    b.mark_mine({ 2, 1 });
+    b.mark_semiknown({ 1, 2 });
+    b.mark_semiknown({ 2, 2 });
+    CHECK(a.signature == b.signature, "signature");
+    bool thrown = false;
+    try {
+        a.mark_batch(one, 1);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown, "marked twice");
+    // The same block twice in one batch
+    const Mark twice[] = { { { 20, 10 }, true }, { { 20, 10 }, false } };
+    const GameData marked = a;
+    thrown = false;
+    try {
+        a.mark_batch_check(twice, 2);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown, "twice in a batch");
+    CHECK(a.signature == marked.signature && a.mines_left == marked.mines_left
+            && a[{ 20, 10 }].status == Block::unknown,
+        "twice unchanged");
+    // More mines than are left
+    a.mines_left = 1;
+    const Mark mined[] = { { { 20, 10 }, true }, { { 22, 10 }, true } };
+    CHECK(!a.mark_batch_check(mined, 2), "mines_left");
+    CHECK(a.mines_left == 1 && a[{ 20, 10 }].status == Block::unknown,
+        "mines_left unchanged");
+    CHECK(a.mark_batch_check(mined, 1), "last mine");
+    CHECK(a.mines_left == 0, "last mine left");
+}
+
+// Whether a and b have the same blocks, mines_left and signature
+bool same_game(const Holy::GameData& a, const Holy::GameData& b) {
+    return std::memcmp(a.blocks.data(), b.blocks.data(), sizeof a.blocks) == 0
+        && a.mines_left == b.mines_left && a.signature == b.signature;
+}
+
+void fork() {
+    std::cout << "\tEnter fork testcase..." << std::endl;
+    using namespace Holy;
+    GameData a;
+    // A 2 and a 1 side by side
+    a.mark_semiknown({ 5, 5 });
+    a.reveal({ 5, 5 }, 2);
+    a.mark_semiknown({ 6, 5 });
+    a.reveal({ 6, 5 }, 1);
+    const GameData before = a;
+    {
+        GameData::Fork outer(a);
+        a.mark_mine({ 4, 4 });
+        a.mark_semiknown({ 5, 6 });
+        a.reveal({ 5, 6 }, 3);
+        CHECK(outer.changes() > 0, "fork logs");
+        CHECK(!same_game(a, before), "fork changes");
+        const GameData middle = a;
+        {
+            GameData::Fork inner(a);
+            a.mark_mine({ 6, 4 });
+            CHECK(outer.changes() > 0 && inner.changes() > 0, "inner logs");
+        }
+        CHECK(same_game(a, middle), "inner rollback");
+        outer.rollback();
+        CHECK(same_game(a, before), "outer rollback");
+        // Still logging after a rollback
+        a.mark_mine({ 4, 4 });
+    }
+    CHECK(same_game(a, before), "fork destroyed");
+    // A fork over marks made in batches
+    const Mark first[] = { { { 4, 4 }, true }, { { 4, 5 }, false } };
+    a.mark_batch(first, 2);
+    const GameData marked = a;
+    {
+        GameData::Fork f(a);
+        const Mark second[] = { { { 4, 6 }, false }, { { 5, 4 }, false },
+            { { 6, 6 }, true } };
+        CHECK(a.mark_batch_check(second, 3), "batch in fork");
+        CHECK(a.mines_left == mines - 2, "batch mines_left");
+    }
+    CHECK(same_game(a, marked), "batch rollback");
+}
+
+// Lays out rows from the top left corner of game, and rest everywhere else:
+// '.' is an unknown safe block, 'x' an unknown mine, '*' a marked mine and
+// 'o' a number, labeled after the mines around it. mines_left becomes the
+// number of x.
+void draw(Holy::GameData& game, const std::vector<std::string>& rows,
+    char rest) {
+    using namespace Holy;
+    const auto at = [&](Point p) {
+        const int x = p.x - 1, y = p.y - 1;
+        return y < (int)rows.size() && x < (int)rows[y].size() ? rows[y][x]
+                                                              : rest;
+    };
+    int hidden = 0;
+    for (int y = 1; y <= row; y++) {
+        for (int x = 1; x <= col; x++) {
+            if (at({ x, y }) == '*')
+                game.mark_mine({ x, y });
+            else if (at({ x, y }) == 'o')
+                game.mark_semiknown({ x, y });
+            else if (at({ x, y }) == 'x')
+                hidden++;
+        }
+    }
+    for (int y = 1; y <= row; y++) {
+        for (int x = 1; x <= col; x++) {
+            if (at({ x, y }) != 'o')
+                continue;
+            int label = 0;
+            Point{ x, y }.for_each_nei8([&](Point np) {
+                label += np.valid() && (at(np) == 'x' || at(np) == '*');
+            });
+            game.reveal({ x, y }, label);
+        }
+    }
+    game.mines_left = hidden;
+}
+
+void kernel() {
+    std::cout << "\tEnter kernel testcase..." << std::endl;
+    using namespace Holy;
+    const std::vector<std::vector<std::string>> positions = {
+        // A line along the top, under a row of numbers
+        { "x.x.x..", "ooooooo", "ooooooo" },
+        // A marked mine in a ring of numbers, which open to the right
+        { "oooo", "o..o", "o.*o", "oxoo", "o..o" },
+        // Numbers scattered among the unknown blocks
+        { "..x.o", "x.oo.", "oo..x", "ooox." },
+        { "ooooo", "x.x.o", "oooxo", ".x..o", "ooooo" },
+    };
+    const Ordering orders[] = { Ordering::scan, Ordering::bfs,
+        Ordering::constrained, Ordering::dynamic };
+    for (const auto& rows : positions) {
+        GameData game;
+        draw(game, rows, '.');
+        for (const auto& comp : front_components(game)) {
+            const int n = comp.size();
+            CHECK(n <= 20, "kernel component size");
+            // Brute force: every assignment of the blocks of comp, checked
+            // against the numbers around them
+            std::vector<Point> numbers;
+            for (const auto& p : comp) {
+                game.for_each_nei8(p, [&](Point np) {
+                    if (game[np].second_init
+                        && std::find(numbers.begin(), numbers.end(), np)
+                            == numbers.end())
+                        numbers.push_back(np);
+                });
+            }
+            std::vector<double> ways(n + 1, 0), mined(n * (n + 1), 0);
+            for (long mask = 0; mask < 1L << n; mask++) {
+                bool fits = true;
+                for (const auto& np : numbers) {
+                    int around = 0;
+                    for (int i = 0; i < n; i++) {
+                        around += (mask >> i & 1)
+                            && std::abs(comp[i].x - np.x) <= 1
+                            && std::abs(comp[i].y - np.y) <= 1;
+                    }
+                    fits = fits && around == game[np].elabel;
+                }
+                if (!fits)
+                    continue;
+                const int j = __builtin_popcountl(mask);
+                ways[j]++;
+                for (int i = 0; i < n; i++)
+                    mined[i * (n + 1) + j] += mask >> i & 1;
+            }
+            for (const Ordering order : orders) {
+                for (const bool learn : { true, false }) {
+                    JohnCache cache;
+                    FrontKernel kernel(game, comp,
+                        std::pmr::get_default_resource(), order);
+                    kernel.learn(learn);
+                    // Searched, then again from the cache
+                    for (int pass = 0; pass < 2; pass++) {
+                        std::pmr::vector<double> out;
+                        CHECK(kernel.count(cache, 1LL << 40, out),
+                            "kernel node_cap");
+                        CHECK(std::equal(ways.begin(), ways.end(),
+                                  out.begin()),
+                            "kernel ways");
+                        CHECK(std::equal(mined.begin(), mined.end(),
+                                  out.begin() + n + 1),
+                            "kernel mined");
+                    }
+                }
+            }
+        }
+    }
+}
+
+void endgame() {
+    std::cout << "\tEnter endgame testcase..." << std::endl;
+    using namespace Holy;
+    const std::vector<std::vector<std::string>> positions = {
+        // The numbers give away the corner mine, and the one in the middle
+        // touches no number: only mines_left says it is a mine
+        { "ooooo", "ox..o", "o.x.o", "o...o", "ooooo" },
+        // The numbers clear the ring, and the three blocks inside share
+        // the two mines left
+        { "ooooooo", "o.....o", "o.x.x.o", "o.....o", "ooooooo" },
+        // Nothing is forced: the corner touches no number, and with two
+        // mines left either it and the block diagonal to it are mines, or
+        // the two x are
+        { ".xo", "x.o", "oo*" },
+        { "oooooo", "o.x..o", "ox...o", "o..x.o", "oooooo" },
+    };
+    for (const auto& rows : positions) {
+        GameData game;
+        draw(game, rows, 'o');
+        // Brute force: every layout of mines_left mines among the unknown
+        // blocks, checked against every number
+        std::vector<Point> cells, numbers;
+        for (int iy = 1; iy <= row; iy++) {
+            for (int ix = 1; ix <= col; ix++) {
+                const Point p{ ix, iy };
+                if (game[p].status == Block::unknown)
+                    cells.push_back(p);
+                else if (game[p].status == Block::number && game[p].vacant_nei)
+                    numbers.push_back(p);
+            }
+        }
+        const int n = cells.size();
+        CHECK(n < 20, "endgame unknown blocks");
+        double total = 0;
+        std::vector<double> mined(n, 0);
+        for (long mask = 0; mask < 1L << n; mask++) {
+            if (__builtin_popcountl(mask) != game.mines_left)
+                continue;
+            bool fits = true;
+            for (const auto& np : numbers) {
+                int around = 0;
+                for (int i = 0; i < n; i++) {
+                    around += (mask >> i & 1)
+                        && std::abs(cells[i].x - np.x) <= 1
+                        && std::abs(cells[i].y - np.y) <= 1;
+                }
+                fits = fits && around == game[np].elabel;
+            }
+            if (!fits)
+                continue;
+            total++;
+            for (int i = 0; i < n; i++)
+                mined[i] += mask >> i & 1;
+        }
+        CHECK(total > 0, "endgame layouts");
+        bool forced = false;
+        for (int i = 0; i < n; i++)
+            forced = forced || mined[i] == 0 || mined[i] == total;
+        const auto result = Holy::endgame(game);
+        CHECK(result.has_value(), "endgame applies");
+        if (forced) {
+            // Every forced block is marked, the others are left alone
+            CHECK(!result->first && !result->second, "endgame marks");
+            for (int i = 0; i < n; i++) {
+                const auto status = game[cells[i]].status;
+                if (mined[i] == total)
+                    CHECK(status == Block::mine, "endgame mine");
+                else if (mined[i] == 0)
+                    CHECK(status == Block::semiknown, "endgame safe");
+                else
+                    CHECK(status == Block::unknown, "endgame unmarked");
+            }
+        } else {
+            CHECK(result->second.has_value(), "endgame chances");
+            for (int i = 0; i < n; i++) {
+                CHECK((*result->second)[cells[i].hash()]
+                        == std::lround(mined[i] / total * chance_scale),
+                    "endgame chance");
+            }
+        }
+    }
+}
+
+// Puts an L of four unknown blocks with numbers around it at (10, 6), in
+// transform t of its 5 by 5 box: bit 0 flips x, bit 1 flips y, bit 2 swaps
+// x and y. comp gets the blocks of the L, id their index in the L.
+void place_pattern(
+    int t, Holy::GameData& game, Holy::Frontier& comp, std::vector<int>& id) {
+    using namespace Holy;
+    const auto at = [t](int x, int y) {
+        if (t & 1)
+            x = 4 - x;
+        if (t & 2)
+            y = 4 - y;
+        if (t & 4)
+            std::swap(x, y);
+        return Point{ 10 + x, 6 + y };
+    };
+    const int numbers[][3] = { { 0, 0, 1 }, { 1, 0, 2 }, { 2, 0, 1 },
+        { 3, 0, 2 }, { 4, 0, 1 }, { 0, 1, 1 }, { 4, 1, 1 }, { 0, 2, 2 },
+        { 2, 2, 1 }, { 1, 3, 1 } };
+    for (const auto& [x, y, label] : numbers) {
+        game[at(x, y)].status = Block::number;
+        game[at(x, y)].label = label;
+    }
+    for (const auto& [x, y, label] : numbers)
+        game.recount(at(x, y));
+    const int cells[][2] = { { 1, 1 }, { 2, 1 }, { 3, 1 }, { 1, 2 } };
+    comp.clear();
+    for (const auto& [x, y] : cells)
+        comp.push_back(at(x, y));
+    // Listed in board order, which differs from one transform to another
+    id = { 0, 1, 2, 3 };
+    std::sort(id.begin(), id.end(), [&](int a, int b) {
+        return comp[a].x != comp[b].x ? comp[a].x < comp[b].x
+                                      : comp[a].y < comp[b].y;
+    });
+    Frontier sorted;
+    for (int i : id)
+        sorted.push_back(comp[i]);
+    comp = std::move(sorted);
+}
+
+void patterns() {
+    std::cout << "\tEnter patterns testcase..." << std::endl;
+    using namespace Holy;
+    const char* path = "mnu_test_patterns.tmp";
+    GameData game;
+    Frontier comp;
+    std::vector<int> id;
+    place_pattern(0, game, comp, id);
+    // Counts that tell the blocks apart: mined[i][j] = 100 * id + j
+    const int n = comp.size();
+    JohnCache::Entry counts;
+    counts.n = n;
+    for (int j = 0; j <= n; j++)
+        counts.ways.push_back(j + 1);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= n; j++)
+            counts.mined.push_back(100 * id[i] + j);
+    }
+    PatternBuilder builder;
+    builder.add(game, comp, counts);
+    builder.write(path);
+    {
+        PatternStore store(path);
+        CHECK(store.size() == 1, "store size");
+        for (int t = 0; t < 8; t++) {
+            GameData other;
+            place_pattern(t, other, comp, id);
+            std::vector<double> found((n + 1) * (n + 1));
+            CHECK(store.find(other, comp, found.data()), "symmetry found");
+            for (int j = 0; j <= n; j++)
+                CHECK(found[j] == counts.ways[j], "symmetry ways");
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j <= n; j++) {
+                    CHECK(found[(n + 1) * (i + 1) + j] == 100 * id[i] + j,
+                        "symmetry mined");
+                }
+            }
+        }
+    }
+    // A header that claims fewer patterns than the slots hold is rejected,
+    // or lookups could find no empty slot to stop at
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    const std::uint64_t wrong = 0;
+    file.seekp(8);
+    file.write(reinterpret_cast<const char*>(&wrong), sizeof wrong);
+    file.close();
+    bool thrown = false;
+    try {
+        PatternStore store(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    CHECK(thrown, "wrong count");
+    std::remove(path);
+}
+
 int main() {
     using namespace Holy;
     std::cout << "Running test cases for mineutils..." << std::endl;
     valid();
     nei4();
+    border();
+    batch();
+    fork();
+    kernel();
+    endgame();
+    patterns();
     std::cout << "Success" << std::endl;
 }
\ No newline at end of file
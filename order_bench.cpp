@@ -0,0 +1,87 @@
+// Contains main()
+// Searches the positions john() is called on in seeded games with
+// FrontKernel in each Ordering, with a cache of their own, with and without
+// nogoods
+// Usage: order_bench [positions] [seed]
+//     positions -- 2000 by default
+// Prints the nodes and time of each, and how many components it cut off or
+// counted differently from the first.
+#include "generator.h"
+#include "kernel.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace Holy;
+
+namespace {
+    // Nodes a search may visit, as in john()
+    constexpr long long order_node_cap = 1 << 21;
+
+    void run_orders(long long count, unsigned seed) {
+        using namespace std::chrono;
+        std::vector<GameData> positions;
+        Butterfly butt;
+        for (unsigned g = 0; (long long)positions.size() < count; g++) {
+            std::seed_seq seq{ seed, g };
+            std::mt19937 rng(seq);
+            butt.start_game({ 10, 10 }, draw_layout({ 10, 10 }, rng));
+            GameData game;
+            game.mark_semiknown({ 10, 10 });
+            accio(game, butt, true);
+            while ((long long)positions.size() < count) {
+                while (roundup(game) || window(game) || felix(game))
+                    accio(game, butt, true);
+                if (butt.verify())
+                    break;
+                positions.push_back(game);
+                if (john(game).second)
+                    break;
+                accio(game, butt, true);
+            }
+        }
+        constexpr Ordering orders[] = { Ordering::scan, Ordering::bfs,
+            Ordering::constrained, Ordering::dynamic };
+        // The counts of every component by the first ordering without nogoods,
+        // to check the others against
+        std::vector<std::pmr::vector<double>> expected;
+        std::cout << positions.size() << " positions\n";
+        for (int run = 0; run < 8; run++) {
+            const Ordering order = orders[run / 2];
+            const bool learn = run % 2;
+            long long nodes = 0, cut = 0, differ = 0, nogoods = 0;
+            std::size_t comp_no = 0;
+            const auto start = steady_clock::now();
+            for (const auto& game : positions) {
+                JohnCache cache;
+                for (const auto& comp : front_components(game)) {
+                    FrontKernel kernel(game, comp,
+                        std::pmr::get_default_resource(), order);
+                    kernel.learn(learn);
+                    std::pmr::vector<double> out;
+                    const bool done = kernel.count(cache, order_node_cap, out);
+                    nodes += kernel.nodes();
+                    nogoods += kernel.nogoods();
+                    cut += !done;
+                    if (run == 0)
+                        expected.push_back(
+                            done ? out : std::pmr::vector<double>());
+                    else if (done && !expected[comp_no].empty())
+                        differ += out != expected[comp_no];
+                    comp_no++;
+                }
+            }
+            const double ms = duration<double, std::milli>(
+                steady_clock::now() - start).count();
+            std::cout << "    " << name(order) << (learn ? " + nogoods" : "")
+                      << ": nodes " << nodes << "    " << ms << "ms    cut off "
+                      << cut << "    counts differ " << differ << "    nogoods "
+                      << nogoods << '\n';
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    run_orders(argc > 1 ? std::atoll(argv[1]) : 2000,
+        argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20201);
+}
@@ -0,0 +1,45 @@
+// Contains main()
+// Grows the pattern store by playing games offline
+// Usage: patgrow <store> [games]
+#include "patterns.h"
+#include "scheduler.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace Holy;
+
+// Plays one game with the deterministic solvers, john() records into the
+// cache given to sched
+void main_loop(Butterfly& butt, Scheduler& sched) {
+    GameData game;
+    butt.start_game({ 10, 10 });
+    game.mark_semiknown({ 10, 10 });
+    accio(game, butt, true);
+    // Stops where it would have to guess
+    sched.solve(game, butt);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: patgrow <store> [games]\n";
+        return 1;
+    }
+    const std::string path = argv[1];
+    const int games = argc > 2 ? std::atoi(argv[2]) : 1000;
+    PatternBuilder builder;
+    if (std::ifstream(path))
+        builder.merge(PatternStore(path));
+    const std::size_t before = builder.size();
+    JohnCache cache;
+    cache.record_to(&builder);
+    Scheduler sched;
+    Advice advice;
+    add_solvers(sched, advice, &cache);
+    Butterfly butt;
+    for (int i = 0; i < games; i++)
+        main_loop(butt, sched);
+    builder.write(path);
+    std::cout << "Patterns: " << before << " -> " << builder.size()
+              << std::endl;
+}
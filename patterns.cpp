@@ -0,0 +1,366 @@
+#include "patterns.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Layout of a store file, integers in native byte order:
+// Header: the magic below, uint64 count of patterns, uint64 count of slots
+// Slots: a hash table of (uint64 hash of key, uint64 offset of record),
+// offset 0 marks an empty slot, probed linearly
+// Records, each at an offset that is a multiple of 8:
+//   uint32 key length, uint32 n, key bytes, padding to 8,
+//   double ways[n + 1], double mined[n * (n + 1)]
+
+namespace {
+    using namespace Holy;
+    using Entry = JohnCache::Entry;
+
+    constexpr char magic[8] = { 'H', 'O', 'L', 'Y', 'P', 'A', 'T', '2' };
+    constexpr std::size_t header_size = 24;
+
+    std::size_t align8(std::size_t x) noexcept {
+        return (x + 7) & ~std::size_t(7);
+    }
+
+    // FNV-1a, stable across builds unlike std::hash
+    std::uint64_t fnv1a(const char* key, std::size_t len) noexcept {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (std::size_t i = 0; i < len; i++) {
+            h ^= (unsigned char)key[i];
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    // A component of at most pattern_max_cells blocks in canonical form,
+    // small enough to live on the stack of a lookup
+    struct Canon {
+        // The first len bytes: width and height of the box around the
+        // component, then the codes of its blocks row by row:
+        // 0 for blocks that have nothing to do with the component,
+        // 1 for blocks of the component,
+        // 2 + elabel * 9 + outside for numbers touching the component,
+        // where outside counts their unknown neighbors not in it
+        char key[2 + col * row];
+        std::size_t len = 0;
+        // perm[i] is the canonical index of comp[i]
+        int perm[pattern_max_cells];
+    };
+
+    // Encodes comp in each of the 8 rotations and reflections of its box and
+    // keeps the smallest encoding. Positions are relative to the box, so the
+    // encoding doesn't change under translation either.
+    void canonical(const GameData& game, const Frontier& comp, Canon& ret) {
+        Checklist in_comp, seen;
+        for (const auto& p : comp)
+            in_comp[p.hash()] = true;
+        // The blocks of comp, then at most 8 numbers around each
+        std::pair<Point, char> codes[pattern_max_cells * 9];
+        int cnt = 0;
+        for (const auto& p : comp)
+            codes[cnt++] = { p, 1 };
+        for (const auto& p : comp) {
+            game.for_each_nei8(p, [&](Point np) {
+                const Block& nb = game[np];
+                if (!nb.second_init || seen[np.hash()])
+                    return;
+                seen[np.hash()] = true;
+                int inner = 0;
+                game.for_each_nei8(np, [&](Point q) {
+                    if (in_comp[q.hash()])
+                        inner++;
+                });
+                codes[cnt++] = {
+                    np, char(2 + nb.elabel * 9 + (nb.vacant_nei - inner)) };
+            });
+        }
+        int minx = col, maxx = 1, miny = row, maxy = 1;
+        for (int c = 0; c < cnt; c++) {
+            const Point p = codes[c].first;
+            minx = std::min(minx, p.x);
+            maxx = std::max(maxx, p.x);
+            miny = std::min(miny, p.y);
+            maxy = std::max(maxy, p.y);
+        }
+        const int w = maxx - minx + 1, h = maxy - miny + 1;
+        // Index of p in the box under transform t:
+        // bit 0 flips x, bit 1 flips y, bit 2 swaps x and y
+        const auto place = [&](Point p, int t) {
+            int x = p.x - minx, y = p.y - miny;
+            if (t & 1)
+                x = w - 1 - x;
+            if (t & 2)
+                y = h - 1 - y;
+            if (t & 4)
+                std::swap(x, y);
+            return 2 + y * ((t & 4) ? h : w) + x;
+        };
+        // Every transform gives a key of the same length, compared as
+        // unsigned bytes
+        ret.len = 2 + w * h;
+        char key[2 + col * row];
+        int best = 0;
+        for (int t = 0; t < 8; t++) {
+            std::memset(key, 0, ret.len);
+            key[0] = (t & 4) ? h : w;
+            key[1] = (t & 4) ? w : h;
+            for (int c = 0; c < cnt; c++)
+                key[place(codes[c].first, t)] = codes[c].second;
+            if (t == 0 || std::memcmp(key, ret.key, ret.len) < 0) {
+                std::memcpy(ret.key, key, ret.len);
+                best = t;
+            }
+        }
+        // Blocks of the component are numbered row by row in the box
+        const int n = comp.size();
+        int order[pattern_max_cells];
+        std::iota(order, order + n, 0);
+        std::sort(order, order + n, [&](int a, int b) {
+            return place(comp[a], best) < place(comp[b], best);
+        });
+        for (int r = 0; r < n; r++)
+            ret.perm[order[r]] = r;
+    }
+
+    // Moves block i of from to block perm[i] of the result
+    Entry permute(const Entry& from, const int* perm) {
+        const int n = from.n;
+        Entry to;
+        to.n = n;
+        to.ways = from.ways;
+        to.mined.resize(from.mined.size());
+        for (int i = 0; i < n; i++) {
+            std::copy_n(
+                from.mined.begin() + i * (n + 1),
+                n + 1,
+                to.mined.begin() + perm[i] * (n + 1));
+        }
+        return to;
+    }
+
+    template <typename T>
+    T load(const unsigned char* at) noexcept {
+        T ret;
+        std::memcpy(&ret, at, sizeof(T));
+        return ret;
+    }
+
+    template <typename T>
+    void store(std::vector<unsigned char>& buf, std::size_t at, T val) {
+        std::memcpy(buf.data() + at, &val, sizeof(T));
+    }
+} // namespace
+
+namespace Holy {
+    PatternStore::PatternStore(const std::string& path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("PatternStore: cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < (off_t)header_size) {
+            ::close(fd);
+            throw std::runtime_error("PatternStore: bad file " + path);
+        }
+        mLength = st.st_size;
+        void* addr = ::mmap(nullptr, mLength, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (addr == MAP_FAILED)
+            throw std::runtime_error("PatternStore: cannot map " + path);
+        mData = static_cast<const unsigned char*>(addr);
+        // Validate everything once, so lookups need no checks
+        const auto bad = [&] {
+            ::munmap(const_cast<unsigned char*>(mData), mLength);
+            return std::runtime_error("PatternStore: malformed " + path);
+        };
+        if (std::memcmp(mData, magic, sizeof(magic)) != 0)
+            throw bad();
+        mCount = load<std::uint64_t>(mData + 8);
+        mSlots = load<std::uint64_t>(mData + 16);
+        if (mSlots == 0 || (mSlots & (mSlots - 1)) != 0 || mCount >= mSlots)
+            throw bad();
+        if (mSlots > (mLength - header_size) / 16)
+            throw bad();
+        // The probes of lookup() end at an empty slot, so there should be
+        // one: the slots in use are counted rather than trusted to the
+        // header
+        std::size_t used = 0;
+        for (std::size_t s = 0; s < mSlots; s++) {
+            const auto offset =
+                load<std::uint64_t>(mData + header_size + s * 16 + 8);
+            if (offset == 0)
+                continue;
+            used++;
+            if (offset % 8 != 0 || offset > mLength - 8)
+                throw bad();
+            const std::size_t key_len = load<std::uint32_t>(mData + offset);
+            const std::size_t n = load<std::uint32_t>(mData + offset + 4);
+            if (n > pattern_max_cells)
+                throw bad();
+            const std::size_t end = align8(offset + 8 + key_len)
+                + 8 * (n + 1) * (n + 1);
+            if (end > mLength)
+                throw bad();
+        }
+        if (used != mCount)
+            throw bad();
+    }
+
+    PatternStore::~PatternStore() noexcept {
+        ::munmap(const_cast<unsigned char*>(mData), mLength);
+    }
+
+    std::size_t PatternStore::size() const noexcept {
+        return mCount;
+    }
+
+    std::size_t PatternStore::lookup(const char* key, std::size_t len) const
+        noexcept {
+        const std::uint64_t h = fnv1a(key, len);
+        for (std::size_t s = h & (mSlots - 1);; s = (s + 1) & (mSlots - 1)) {
+            const unsigned char* slot = mData + header_size + s * 16;
+            const auto offset = load<std::uint64_t>(slot + 8);
+            if (offset == 0)
+                return 0;
+            if (load<std::uint64_t>(slot) != h)
+                continue;
+            const std::size_t key_len = load<std::uint32_t>(mData + offset);
+            if (key_len == len
+                && std::memcmp(mData + offset + 8, key, len) == 0)
+                return offset;
+        }
+    }
+
+    Entry PatternStore::read(std::size_t offset) const {
+        const std::size_t key_len = load<std::uint32_t>(mData + offset);
+        const int n = load<std::uint32_t>(mData + offset + 4);
+        const unsigned char* at = mData + align8(offset + 8 + key_len);
+        Entry ret;
+        ret.n = n;
+        ret.ways.resize(n + 1);
+        ret.mined.resize(n * (n + 1));
+        std::memcpy(ret.ways.data(), at, 8 * (n + 1));
+        std::memcpy(ret.mined.data(), at + 8 * (n + 1), 8 * n * (n + 1));
+        return ret;
+    }
+
+    bool PatternStore::find(
+        const GameData& game,
+        const Frontier& comp,
+        double* counts) const {
+        const int n = comp.size();
+        if (n > pattern_max_cells)
+            return false;
+        Canon canon;
+        canonical(game, comp, canon);
+        const std::size_t offset = lookup(canon.key, canon.len);
+        if (offset == 0)
+            return false;
+        const std::size_t key_len = load<std::uint32_t>(mData + offset);
+        const unsigned char* at = mData + align8(offset + 8 + key_len);
+        std::memcpy(counts, at, 8 * (n + 1));
+        // Back from canonical order to the order of comp
+        at += 8 * (n + 1);
+        for (int i = 0; i < n; i++) {
+            std::memcpy(counts + (n + 1) * (i + 1),
+                at + 8 * (n + 1) * canon.perm[i],
+                8 * (n + 1));
+        }
+        return true;
+    }
+
+    const PatternStore* PatternStore::shared() {
+        static const std::unique_ptr<PatternStore> store = [] {
+            const char* path = std::getenv("HOLY_PATTERNS");
+            std::unique_ptr<PatternStore> ret;
+            if (!path)
+                return ret;
+            try {
+                ret = std::make_unique<PatternStore>(path);
+            } catch (const std::runtime_error&) {
+                // Run without the store rather than fail
+            }
+            return ret;
+        }();
+        return store.get();
+    }
+
+    void PatternBuilder::add(
+        const GameData& game,
+        const Frontier& comp,
+        const JohnCache::Entry& counts) {
+        if ((int)comp.size() > pattern_max_cells)
+            return;
+        Canon canon;
+        canonical(game, comp, canon);
+        std::string key(canon.key, canon.len);
+        if (mRecords.count(key))
+            return;
+        mRecords.emplace(std::move(key), permute(counts, canon.perm));
+    }
+
+    void PatternBuilder::merge(const PatternStore& store) {
+        for (std::size_t s = 0; s < store.mSlots; s++) {
+            const unsigned char* slot = store.mData + header_size + s * 16;
+            const auto offset = load<std::uint64_t>(slot + 8);
+            if (offset == 0)
+                continue;
+            const std::size_t key_len =
+                load<std::uint32_t>(store.mData + offset);
+            const char* key =
+                reinterpret_cast<const char*>(store.mData + offset + 8);
+            mRecords.emplace(std::string(key, key_len), store.read(offset));
+        }
+    }
+
+    std::size_t PatternBuilder::size() const noexcept {
+        return mRecords.size();
+    }
+
+    void PatternBuilder::write(const std::string& path) const {
+        std::size_t slots = 8;
+        while (slots < 2 * mRecords.size())
+            slots *= 2;
+        std::vector<unsigned char> buf(header_size + slots * 16, 0);
+        std::memcpy(buf.data(), magic, sizeof(magic));
+        store<std::uint64_t>(buf, 8, mRecords.size());
+        store<std::uint64_t>(buf, 16, slots);
+        for (const auto& [key, counts] : mRecords) {
+            const int n = counts.n;
+            const std::size_t offset = buf.size();
+            const std::size_t data = align8(offset + 8 + key.size());
+            buf.resize(data + 8 * (n + 1) * (n + 1), 0);
+            store<std::uint32_t>(buf, offset, key.size());
+            store<std::uint32_t>(buf, offset + 4, n);
+            std::memcpy(buf.data() + offset + 8, key.data(), key.size());
+            std::memcpy(buf.data() + data, counts.ways.data(), 8 * (n + 1));
+            std::memcpy(
+                buf.data() + data + 8 * (n + 1),
+                counts.mined.data(),
+                8 * n * (n + 1));
+            // Insert into the hash table
+            const std::uint64_t h = fnv1a(key.data(), key.size());
+            std::size_t s = h & (slots - 1);
+            while (load<std::uint64_t>(buf.data() + header_size + s * 16 + 8))
+                s = (s + 1) & (slots - 1);
+            store<std::uint64_t>(buf, header_size + s * 16, h);
+            store<std::uint64_t>(buf, header_size + s * 16 + 8, offset);
+        }
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream file(tmp, std::ios::out | std::ios::binary);
+            file.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+            if (!file)
+                throw std::runtime_error("PatternBuilder: cannot write " + tmp);
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0)
+            throw std::runtime_error("PatternBuilder: cannot rename " + tmp);
+    }
+} // namespace Holy
@@ -0,0 +1,100 @@
+#ifndef PATTERNS_H
+#define PATTERNS_H
+
+#include "solvers.h"
+#include <map>
+#include <string>
+
+/// @file patterns.h On-disk store of solved frontier components
+/// Small components (1-2-1 lines, corner patterns...) recur in many games.
+/// The store keys each one by a canonical encoding that does not change
+/// under translation, rotation and reflection, so john() can look them up
+/// instead of searching them again.
+
+namespace Holy {
+    /// @brief Largest component, in unknown blocks, that goes into the store
+    constexpr int pattern_max_cells = 16;
+
+    /// @brief A read-only store of patterns, memory-mapped from a file
+    ///
+    /// Every process mapping the same file shares its pages, so a store
+    /// can serve many workers at the cost of one copy.
+    class PatternStore {
+    public:
+        /// @brief Maps the store at path
+        /// @exception std::runtime_error if the file cannot be mapped or is
+        /// not a well-formed store
+        explicit PatternStore(const std::string& path);
+
+        // Copy operations are not permitted.
+        PatternStore(const PatternStore& src) = delete;
+
+        // Copy operations are not permitted.
+        PatternStore& operator=(const PatternStore& src) = delete;
+
+        // Unmaps the file
+        ~PatternStore() noexcept;
+
+        /// @brief Looks up the component comp of game, without allocating
+        /// @param counts -- room for (n + 1)^2 counts, n the size of comp,
+        /// which get the counts of the pattern laid out as in
+        /// JohnCache::find(), blocks in the order of comp
+        /// @returns whether comp is in the store, counts is unchanged if not
+        bool find(const GameData& game, const Frontier& comp, double* counts)
+            const;
+
+        /// @returns the number of patterns in the store
+        std::size_t size() const noexcept;
+
+        /// @brief The store shared by the whole process
+        /// Mapped on first use from the file named by the environment
+        /// variable HOLY_PATTERNS.
+        /// @returns nullptr if the variable is unset or the file unusable
+        static const PatternStore* shared();
+
+    private:
+        friend class PatternBuilder;
+
+        // Looks up a canonical key, returns the offset of its record or 0
+        std::size_t lookup(const char* key, std::size_t len) const noexcept;
+
+        // Reads the record at offset, blocks in canonical order
+        JohnCache::Entry read(std::size_t offset) const;
+
+        const unsigned char* mData = nullptr;
+        std::size_t mLength = 0;
+        std::size_t mCount = 0, mSlots = 0;
+    };
+
+    /// @brief Collects solved components and writes them as a store
+    ///
+    /// Offline runs record into a builder (see JohnCache::record_to()),
+    /// merge the existing store and write the grown one in its place.
+    class PatternBuilder {
+    public:
+        /// @brief Adds component comp of game with its counts,
+        /// ignored if comp is larger than pattern_max_cells
+        void add(
+            const GameData& game,
+            const Frontier& comp,
+            const JohnCache::Entry& counts);
+
+        /// @brief Adds every pattern of store
+        void merge(const PatternStore& store);
+
+        /// @returns the number of distinct patterns collected
+        std::size_t size() const noexcept;
+
+        /// @brief Writes the patterns as a store at path
+        /// The file is written aside and renamed over path, so processes
+        /// that still map the old store are unaffected.
+        /// @exception std::runtime_error on I/O errors
+        void write(const std::string& path) const;
+
+    private:
+        // Canonical key -> counts, blocks in canonical order
+        std::map<std::string, JohnCache::Entry> mRecords;
+    };
+} // namespace Holy
+
+#endif // PATTERNS_H
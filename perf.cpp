@@ -0,0 +1,131 @@
+#include "perf.h"
+#include <cstdint>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    using namespace Holy;
+
+#ifdef __linux__
+    // type and config of each Event
+    struct Config {
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    constexpr Config configs[perf::event_count] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    // Opens an event of the calling thread in the group of leader, or as a
+    // leader if it is -1. Returns the descriptor, or -1.
+    int open_event(const Config& c, int leader) noexcept {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof attr);
+        attr.size = sizeof attr;
+        attr.type = c.type;
+        attr.config = c.config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    }
+#endif
+} // namespace
+
+namespace Holy {
+    namespace perf {
+        const char* name(Event e) noexcept {
+            switch (e) {
+                case cycles:
+                    return "cycles";
+                case instructions:
+                    return "instructions";
+                case l1d_misses:
+                    return "L1d misses";
+                case llc_misses:
+                    return "LLC misses";
+                case branch_misses:
+                    return "branch misses";
+                default:
+                    return "?";
+            }
+        }
+
+        Sample& Sample::operator+=(const Sample& rhs) noexcept {
+            for (int e = 0; e < event_count; e++)
+                count[e] += rhs.count[e];
+            return *this;
+        }
+
+        Sample operator-(const Sample& lhs, const Sample& rhs) noexcept {
+            Sample ret;
+            for (int e = 0; e < event_count; e++)
+                ret.count[e] = lhs.count[e] - rhs.count[e];
+            return ret;
+        }
+
+        Counters::Counters() noexcept {
+            mFd.fill(-1);
+            mSlot.fill(-1);
+#ifdef __linux__
+            // The first event that opens leads the group, so the rest are
+            // counted over the same stretches of time
+            for (int e = 0; e < event_count; e++) {
+                const int fd = open_event(configs[e], mLeader);
+                if (fd < 0)
+                    continue;
+                if (mLeader < 0)
+                    mLeader = fd;
+                mFd[e] = fd;
+                mSlot[e] = mOpened++;
+            }
+#endif
+        }
+
+        Counters::~Counters() noexcept {
+#ifdef __linux__
+            for (int fd : mFd) {
+                if (fd >= 0)
+                    close(fd);
+            }
+#endif
+        }
+
+        bool Counters::available(Event e) const noexcept {
+            return mSlot[e] >= 0;
+        }
+
+        bool Counters::any() const noexcept {
+            return mOpened > 0;
+        }
+
+        Sample Counters::read() const noexcept {
+            Sample ret;
+#ifdef __linux__
+            if (mLeader < 0)
+                return ret;
+            // nr, then a value per member in the order they were opened
+            std::uint64_t buf[1 + event_count];
+            if (::read(mLeader, buf, sizeof buf) < (ssize_t)sizeof(buf[0]))
+                return ret;
+            for (int e = 0; e < event_count; e++) {
+                if (mSlot[e] >= 0 && mSlot[e] < (int)buf[0])
+                    ret.count[e] = buf[1 + mSlot[e]];
+            }
+#endif
+            return ret;
+        }
+    } // namespace perf
+} // namespace Holy
@@ -0,0 +1,75 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <array>
+
+/// @file perf.h Hardware event counters of the calling thread
+/// On Linux the counters come from perf_event_open(2), counting user space
+/// only, read all at once as a group. Where the kernel, the machine or its
+/// hypervisor does not provide an event, that event is unavailable and
+/// reads as 0; elsewhere, all of them are.
+
+namespace Holy {
+    namespace perf {
+        enum Event {
+            cycles,
+            instructions,
+            /// Level 1 data cache read misses
+            l1d_misses,
+            /// Last level cache misses
+            llc_misses,
+            branch_misses,
+            event_count
+        };
+
+        /// @returns a short name of e, for reports
+        const char* name(Event e) noexcept;
+
+        /// @brief Event counts, indexed by Event
+        struct Sample {
+            std::array<long long, event_count> count{};
+
+            Sample& operator+=(const Sample& rhs) noexcept;
+        };
+
+        /// @returns the counts between two readings, lhs the later one
+        Sample operator-(const Sample& lhs, const Sample& rhs) noexcept;
+
+        /// @brief The counters of the thread that made it, counting from
+        /// the start
+        class Counters {
+        public:
+            /// Opens every event that can be opened, never throws for one
+            /// that cannot
+            Counters() noexcept;
+
+            // Copy operations are not permitted.
+            Counters(const Counters& src) = delete;
+
+            // Copy operations are not permitted.
+            Counters& operator=(const Counters& src) = delete;
+
+            ~Counters() noexcept;
+
+            /// @returns whether e is being counted
+            bool available(Event e) const noexcept;
+
+            /// @returns whether any event is being counted
+            bool any() const noexcept;
+
+            /// @returns the counts so far, with one system call
+            Sample read() const noexcept;
+
+        private:
+            // The group leader, and each event's descriptor, -1 if it is
+            // unavailable
+            int mLeader = -1;
+            std::array<int, event_count> mFd;
+            // Position of each event in a group read, -1 if unavailable
+            std::array<int, event_count> mSlot;
+            int mOpened = 0;
+        };
+    } // namespace perf
+} // namespace Holy
+
+#endif // PERF_H
@@ -0,0 +1,101 @@
+// Contains main()
+// Plays seeded games with the adaptive scheduler and appends a row per game
+// to a results file (see results.h) for result_stats
+// Usage: record_bench <file> [games] [seed]
+//     games -- 10000 by default
+// A game that is lost is one the solvers got stuck on, as nothing is
+// guessed: rounds and unknown tell where. The board metrics let
+// result_stats -g bbbv_bucket split the games by difficulty.
+#include "generator.h"
+#include "results.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Holy;
+
+namespace {
+    void run_record(const std::string& path, long long games, unsigned seed) {
+        using results::Encoding;
+        Advice advice;
+        Scheduler sched;
+        add_solvers(sched, advice);
+        const int john = sched.find("john");
+        std::vector<results::Column> columns = { { "seed", Encoding::delta },
+            { "game", Encoding::delta }, { "won" }, { "rounds" }, { "unknown" },
+            { "mines_left" }, { "john_runs" }, { "john_fired" }, { "bbbv" },
+            { "bbbv_bucket" }, { "openings" }, { "largest_opening" },
+            { "isolated" } };
+        for (int i = 0; i < sched.size(); i++)
+            columns.push_back({ sched.stage(i).name + "_us" });
+        columns.push_back({ "accio_us" });
+        std::vector<std::uint64_t> values(columns.size());
+        // Stats of the stages, then of accio, before the game
+        std::vector<Scheduler::Stats> base(sched.size() + 1);
+        Butterfly butt;
+        butt.measure(true);
+        long long won = 0;
+        {
+            results::Writer out(path, std::move(columns));
+            for (long long g = 0; g < games; g++) {
+                for (int i = 0; i < sched.size(); i++)
+                    base[i] = sched.stats(i);
+                base.back() = sched.accio_stats();
+                std::seed_seq seq{ seed, (unsigned)g };
+                std::mt19937 rng(seq);
+                butt.start_game({ 10, 10 }, draw_layout({ 10, 10 }, rng));
+                GameData game;
+                game.mark_semiknown({ 10, 10 });
+                accio(game, butt, true);
+                sched.solve(game, butt);
+                int unknown = 0;
+                for (int ix = 1; ix <= col; ix++) {
+                    for (int iy = 1; iy <= row; iy++)
+                        unknown += game[{ ix, iy }].status == Block::unknown;
+                }
+                const bool win = butt.verify();
+                won += win;
+                const auto& accio_st = sched.accio_stats();
+                int k = 0;
+                values[k++] = seed;
+                values[k++] = g;
+                values[k++] = win;
+                // The first click is made before the scheduler starts
+                values[k++] = accio_st.runs - base.back().runs + 1;
+                values[k++] = unknown;
+                values[k++] = game.mines_left;
+                values[k++] = sched.stats(john).runs - base[john].runs;
+                values[k++] = sched.stats(john).fired - base[john].fired;
+                const BoardMetrics& metrics = *butt.metrics();
+                values[k++] = metrics.bbbv;
+                values[k++] = bbbv_bucket(metrics);
+                values[k++] = metrics.openings;
+                values[k++] = metrics.largest_opening;
+                values[k++] = metrics.isolated;
+                for (int i = 0; i < sched.size(); i++) {
+                    const auto& st = sched.stats(i);
+                    values[k++] = (st.nanoseconds - base[i].nanoseconds) / 1000;
+                }
+                values[k++] =
+                    (accio_st.nanoseconds - base.back().nanoseconds) / 1000;
+                out.add(values.data());
+            }
+        }
+        std::cout << games << " games, " << won << " won, appended to " << path
+                  << '\n';
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: record_bench <file> [games] [seed]\n";
+        return 1;
+    }
+    try {
+        run_record(argv[1], argc > 2 ? std::atoll(argv[2]) : 10000,
+            argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20201);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
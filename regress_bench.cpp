@@ -0,0 +1,180 @@
+// Contains main()
+// Plays a fixed, seeded set of games and checks the throughput against a
+// baseline
+// Usage: regress_bench <baseline> [games] [threshold] [repeats]
+//     baseline  -- JSON file from an earlier run, written by this run if
+//                  there is none
+//     games     -- games per repeat, 500 by default
+//     threshold -- percent of games/s that may be lost, 10 by default
+//     repeats   -- the fastest of these is kept, 3 by default
+// Prints the result as JSON, with the games/s of each bucket of 3BV (see
+// bbbv_bounds) so hard boards are not lost among easy ones. Exits with 2 if
+// games/s fell by more than threshold, or the baseline played other games.
+#include "generator.h"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace Holy;
+
+namespace {
+    constexpr unsigned seed = 20201;
+
+    // The games of a run whose boards are in a bucket of 3BV
+    struct Bucket {
+        long long games = 0, wins = 0;
+        double seconds = 0;
+    };
+
+    // A run of the games
+    struct Result {
+        long long games = 0, wins = 0;
+        double seconds = 0;
+        std::array<Bucket, bbbv_bounds.size() + 1> buckets;
+        // name and stats of each stage, then of accio
+        std::vector<std::pair<std::string, Scheduler::Stats>> stages;
+    };
+
+    Result play(long long games) {
+        using namespace std::chrono;
+        // A cache of its own, so earlier repeats do not warm it
+        JohnCache cache;
+        Advice advice;
+        Scheduler sched;
+        add_solvers(sched, advice, &cache);
+        Butterfly butt;
+        butt.measure(true);
+        Result ret;
+        ret.games = games;
+        const auto start = steady_clock::now();
+        for (long long g = 0; g < games; g++) {
+            std::seed_seq seq{ seed, (unsigned)g };
+            std::mt19937 rng(seq);
+            const Checklist mined = draw_layout({ 10, 10 }, rng);
+            const auto game_start = steady_clock::now();
+            butt.start_game({ 10, 10 }, mined);
+            GameData game;
+            game.mark_semiknown({ 10, 10 });
+            accio(game, butt, true);
+            sched.solve(game, butt);
+            const bool won = butt.verify();
+            ret.wins += won;
+            auto& bucket = ret.buckets[bbbv_bucket(*butt.metrics())];
+            bucket.games++;
+            bucket.wins += won;
+            bucket.seconds +=
+                duration<double>(steady_clock::now() - game_start).count();
+        }
+        ret.seconds = duration<double>(steady_clock::now() - start).count();
+        for (int i = 0; i < sched.size(); i++)
+            ret.stages.emplace_back(sched.stage(i).name, sched.stats(i));
+        ret.stages.emplace_back("accio", sched.accio_stats());
+        return ret;
+    }
+
+    std::string to_json(const Result& r) {
+        std::ostringstream out;
+        out << "{\n  \"games\": " << r.games << ",\n  \"seed\": " << seed
+            << ",\n  \"wins\": " << r.wins << ",\n  \"seconds\": " << r.seconds
+            << ",\n  \"games_per_sec\": " << r.games / r.seconds
+            << ",\n  \"stages\": {";
+        for (std::size_t i = 0; i < r.stages.size(); i++) {
+            const auto& [name, st] = r.stages[i];
+            out << (i ? ",\n" : "\n") << "    \"" << name
+                << "\": { \"runs\": " << st.runs
+                << ", \"ms\": " << st.nanoseconds / 1e6 << " }";
+        }
+        out << "\n  },\n  \"bbbv_buckets\": {";
+        for (std::size_t i = 0; i < r.buckets.size(); i++) {
+            const auto& b = r.buckets[i];
+            out << (i ? ",\n" : "\n") << "    \"" << bbbv_range(i)
+                << "\": { \"games\": " << b.games << ", \"wins\": " << b.wins
+                << ", \"games_per_sec\": "
+                << (b.seconds > 0 ? b.games / b.seconds : 0) << " }";
+        }
+        out << "\n  }\n}\n";
+        return out.str();
+    }
+
+    // The number after "key": in text, from position from on, or NaN
+    double number(const std::string& text, const std::string& key,
+        std::size_t from = 0) {
+        const auto at = text.find('"' + key + "\":", from);
+        if (at == std::string::npos)
+            return std::nan("");
+        return std::strtod(text.c_str() + at + key.size() + 3, nullptr);
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: regress_bench <baseline> [games] [threshold] "
+                     "[repeats]\n";
+        return 1;
+    }
+    const long long games = argc > 2 ? std::atoll(argv[2]) : 500;
+    const double threshold = argc > 3 ? std::atof(argv[3]) : 10;
+    const int repeats = argc > 4 ? std::atoi(argv[4]) : 3;
+    if (games <= 0 || repeats <= 0) {
+        std::cerr << "games and repeats should be positive\n";
+        return 1;
+    }
+    Result best;
+    for (int i = 0; i < repeats; i++) {
+        Result r = play(games);
+        if (i == 0 || r.seconds < best.seconds)
+            best = std::move(r);
+    }
+    const std::string json = to_json(best);
+    std::cout << json;
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::ofstream(argv[1]) << json;
+        std::cerr << "No baseline, wrote " << argv[1] << '\n';
+        return 0;
+    }
+    std::stringstream buf;
+    buf << in.rdbuf();
+    const std::string base = buf.str();
+    if (number(base, "games") != games || number(base, "seed") != seed) {
+        std::cerr << "The baseline played other games\n";
+        return 2;
+    }
+    if (number(base, "wins") != best.wins)
+        std::cerr << "Wins changed from " << number(base, "wins") << '\n';
+    for (const auto& [name, st] : best.stages) {
+        const auto at = base.find('"' + name + "\": {");
+        const double ms = number(base, "ms", at);
+        if (at != std::string::npos && ms > 0) {
+            std::cerr << name << ": " << st.nanoseconds / 1e6 << "ms, "
+                      << 100 * (st.nanoseconds / 1e6 - ms) / ms
+                      << "% against the baseline\n";
+        }
+    }
+    for (std::size_t i = 0; i < best.buckets.size(); i++) {
+        const auto& b = best.buckets[i];
+        const auto at = base.find('"' + bbbv_range(i) + "\": {");
+        const double base_rate = number(base, "games_per_sec", at);
+        if (at != std::string::npos && base_rate > 0 && b.seconds > 0) {
+            std::cerr << "3BV " << bbbv_range(i) << ": " << b.games
+                      << " games, " << b.games / b.seconds << " games/s, "
+                      << 100 * (b.games / b.seconds - base_rate) / base_rate
+                      << "% against the baseline\n";
+        }
+    }
+    const double base_rate = number(base, "games_per_sec");
+    const double rate = best.games / best.seconds;
+    const double change = 100 * (rate - base_rate) / base_rate;
+    std::cerr << "games/s: " << rate << ", " << change
+              << "% against the baseline\n";
+    if (!(change >= -threshold)) {
+        std::cerr << "Throughput regressed by more than " << threshold
+                  << "%\n";
+        return 2;
+    }
+}
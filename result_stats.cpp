@@ -0,0 +1,175 @@
+// Contains main()
+// Sums up results files written by record_bench, in one pass
+// Usage: result_stats [-l] [-g column] <file>... [filter]...
+//     -l        -- also prints the rows that pass the filters
+//     -g column -- sums up the rows of each value of column apart
+//     filter    -- column, one of = != < <= > >=, and a number, as in
+//                  won=0 or john_runs>=2; a row should pass all of them
+// Prints, for the rows that pass, the mean, minimum and maximum of every
+// column.
+#include "results.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Holy;
+
+namespace {
+    struct Filter {
+        int column;
+        std::string op;
+        std::uint64_t value;
+
+        bool pass(const std::uint64_t* values) const noexcept {
+            const std::uint64_t x = values[column];
+            if (op == "=")
+                return x == value;
+            if (op == "!=")
+                return x != value;
+            if (op == "<")
+                return x < value;
+            if (op == "<=")
+                return x <= value;
+            if (op == ">")
+                return x > value;
+            return x >= value;
+        }
+    };
+
+    // Reads a filter on the columns from arg, which has an operator
+    Filter parse_filter(
+        const std::string& arg, const std::vector<results::Column>& columns) {
+        Filter out;
+        const auto at = arg.find_first_of("=!<>");
+        const auto end = arg.find_first_not_of("=!<>", at);
+        out.op = arg.substr(at, end - at);
+        if (out.op != "=" && out.op != "!=" && out.op != "<" && out.op != "<="
+            && out.op != ">" && out.op != ">=")
+            throw std::invalid_argument("Unknown operator in " + arg);
+        const std::string name = arg.substr(0, at);
+        out.column = -1;
+        for (std::size_t c = 0; c < columns.size(); c++) {
+            if (columns[c].name == name)
+                out.column = c;
+        }
+        if (out.column < 0)
+            throw std::invalid_argument("No column " + name);
+        out.value = std::strtoull(arg.c_str() + end, nullptr, 10);
+        return out;
+    }
+
+    // Rows summed up
+    struct Summary {
+        long long rows = 0;
+        std::vector<double> sum;
+        std::vector<std::uint64_t> min, max;
+
+        void add(const std::uint64_t* values, std::size_t n) {
+            if (rows++ == 0) {
+                sum.assign(n, 0);
+                min.assign(values, values + n);
+                max.assign(values, values + n);
+            }
+            for (std::size_t c = 0; c < n; c++) {
+                sum[c] += values[c];
+                min[c] = std::min(min[c], values[c]);
+                max[c] = std::max(max[c], values[c]);
+            }
+        }
+    };
+
+    void print(const Summary& s, const std::vector<results::Column>& columns) {
+        std::cout << s.rows << " rows\n";
+        if (s.rows == 0)
+            return;
+        std::cout << "    column  mean  min  max\n";
+        for (std::size_t c = 0; c < columns.size(); c++) {
+            std::cout << "    " << columns[c].name << "  " << s.sum[c] / s.rows
+                      << "  " << s.min[c] << "  " << s.max[c] << '\n';
+        }
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    bool list = false;
+    std::string group;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "-l")
+            list = true;
+        else if (arg == "-g" && i + 1 < argc)
+            group = argv[++i];
+        else
+            args.push_back(arg);
+    }
+    std::vector<std::string> files, filter_args;
+    for (const auto& arg : args) {
+        (arg.find_first_of("=!<>") == std::string::npos ? files : filter_args)
+            .push_back(arg);
+    }
+    if (files.empty()) {
+        std::cerr << "Usage: result_stats [-l] [-g column] <file>... "
+                     "[filter]...\n";
+        return 1;
+    }
+    try {
+        std::vector<results::Column> columns;
+        std::vector<Filter> filters;
+        int group_column = -1;
+        std::map<std::uint64_t, Summary> groups;
+        Summary all;
+        long long total = 0;
+        for (const auto& file : files) {
+            results::Reader in(file);
+            if (columns.empty()) {
+                columns = in.columns();
+                for (const auto& arg : filter_args)
+                    filters.push_back(parse_filter(arg, columns));
+                if (!group.empty() && (group_column = in.find(group)) < 0)
+                    throw std::invalid_argument("No column " + group);
+                if (list) {
+                    for (std::size_t c = 0; c < columns.size(); c++)
+                        std::cout << (c ? "\t" : "") << columns[c].name;
+                    std::cout << '\n';
+                }
+            } else if (in.columns().size() != columns.size()
+                || !std::equal(columns.begin(), columns.end(),
+                    in.columns().begin(),
+                    [](const results::Column& a, const results::Column& b) {
+                        return a.name == b.name;
+                    })) {
+                throw std::invalid_argument(file + " has other columns");
+            }
+            std::vector<std::uint64_t> values(columns.size());
+            while (in.next(values.data())) {
+                total++;
+                if (!std::all_of(filters.begin(), filters.end(),
+                        [&](const Filter& f) { return f.pass(values.data()); }))
+                    continue;
+                all.add(values.data(), values.size());
+                if (group_column >= 0)
+                    groups[values[group_column]].add(
+                        values.data(), values.size());
+                if (list) {
+                    for (std::size_t c = 0; c < values.size(); c++)
+                        std::cout << (c ? "\t" : "") << values[c];
+                    std::cout << '\n';
+                }
+            }
+        }
+        std::cout << total << " rows read, ";
+        print(all, columns);
+        for (const auto& [value, summary] : groups) {
+            std::cout << group << " = " << value << ": ";
+            print(summary, columns);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,233 @@
+#include "results.h"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    using namespace Holy::results;
+
+    constexpr char magic[8] = { 'H', 'O', 'L', 'Y', 'R', 'E', 'S', '1' };
+
+    void put_varint(std::vector<std::uint8_t>& out, std::uint64_t x) {
+        for (; x >= 0x80; x >>= 7)
+            out.push_back(std::uint8_t(x | 0x80));
+        out.push_back(std::uint8_t(x));
+    }
+
+    // Reads a varint from bytes[at, end), returns false if it runs past end
+    bool get_varint(const std::vector<std::uint8_t>& bytes, std::size_t& at,
+        std::size_t end, std::uint64_t& x) noexcept {
+        x = 0;
+        for (int shift = 0; at < end && shift < 64; shift += 7) {
+            const std::uint8_t b = bytes[at++];
+            x |= std::uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename T>
+    void put(std::ostream& out, T x) {
+        out.write(reinterpret_cast<const char*>(&x), sizeof x);
+    }
+
+    template <typename T>
+    bool get(std::istream& in, T& x) {
+        return bool(in.read(reinterpret_cast<char*>(&x), sizeof x));
+    }
+
+    // Reads the header, returns false if there is none
+    bool read_header(std::istream& in, std::vector<Column>& columns) {
+        char head[sizeof magic];
+        std::uint32_t count;
+        if (!in.read(head, sizeof head) || std::memcmp(head, magic, sizeof head)
+            || !get(in, count))
+            return false;
+        columns.assign(count, {});
+        for (auto& c : columns) {
+            std::uint8_t encoding, length;
+            if (!get(in, encoding) || !get(in, length) || encoding > 1)
+                return false;
+            c.encoding = Encoding(encoding);
+            c.name.resize(length);
+            if (!in.read(c.name.data(), length))
+                return false;
+        }
+        return true;
+    }
+
+    // Skips the blocks from the position of in on, in a file of size
+    // bytes, and returns where the last whole one ends
+    std::streamoff skip_blocks(
+        std::istream& in, std::size_t columns, std::streamoff size) {
+        std::streamoff end = in.tellg();
+        std::uint32_t rows, bytes;
+        while (get(in, rows)) {
+            std::streamoff at = in.tellg();
+            std::size_t c = 0;
+            for (; c < columns && get(in, bytes); c++)
+                at += sizeof bytes + bytes;
+            if (c < columns || at > size || !in.seekg(at))
+                break;
+            end = at;
+        }
+        return end;
+    }
+
+    bool same(const std::vector<Column>& lhs, const std::vector<Column>& rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (std::size_t c = 0; c < lhs.size(); c++) {
+            if (lhs[c].name != rhs[c].name
+                || lhs[c].encoding != rhs[c].encoding)
+                return false;
+        }
+        return true;
+    }
+} // namespace
+
+namespace Holy {
+    namespace results {
+        Writer::Writer(const std::string& path, std::vector<Column> columns) :
+            mColumns(std::move(columns)),
+            mBytes(mColumns.size()),
+            mLast(mColumns.size(), 0) {
+            // A file with rows in it keeps its header, and loses the end of
+            // a block cut short so the new blocks can be read
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            const std::streamoff size = in ? std::streamoff(in.tellg()) : 0;
+            const bool empty = size == 0;
+            if (!empty) {
+                std::vector<Column> existing;
+                in.seekg(0);
+                if (!read_header(in, existing) || !same(existing, mColumns))
+                    throw std::runtime_error(path + " has other columns");
+                const std::streamoff end =
+                    skip_blocks(in, mColumns.size(), size);
+                in.close();
+                if (end < size)
+                    std::filesystem::resize_file(path, end);
+            }
+            mFile.open(path, std::ios::binary | std::ios::app);
+            if (!mFile)
+                throw std::runtime_error("Cannot open " + path);
+            if (empty) {
+                mFile.write(magic, sizeof magic);
+                put<std::uint32_t>(mFile, mColumns.size());
+                for (const auto& c : mColumns) {
+                    put<std::uint8_t>(mFile, std::uint8_t(c.encoding));
+                    put<std::uint8_t>(mFile, c.name.size());
+                    mFile << c.name;
+                }
+            }
+        }
+
+        Writer::~Writer() noexcept {
+            try {
+                flush();
+            } catch (const std::runtime_error&) {
+                // Nowhere to report it
+            }
+        }
+
+        void Writer::add(const std::uint64_t* values) {
+            for (std::size_t c = 0; c < mColumns.size(); c++) {
+                std::uint64_t x = values[c];
+                if (mColumns[c].encoding == Encoding::delta) {
+                    const std::int64_t d = std::int64_t(x - mLast[c]);
+                    mLast[c] = x;
+                    x = std::uint64_t(d) << 1 ^ std::uint64_t(d >> 63);
+                }
+                put_varint(mBytes[c], x);
+            }
+            if (++mRows == block_rows)
+                flush();
+        }
+
+        void Writer::flush() {
+            if (mRows == 0)
+                return;
+            put<std::uint32_t>(mFile, mRows);
+            for (const auto& bytes : mBytes)
+                put<std::uint32_t>(mFile, bytes.size());
+            for (auto& bytes : mBytes) {
+                mFile.write(reinterpret_cast<const char*>(bytes.data()),
+                    bytes.size());
+                bytes.clear();
+            }
+            mLast.assign(mColumns.size(), 0);
+            mRows = 0;
+            if (!mFile.flush())
+                throw std::runtime_error("Cannot write the results");
+        }
+
+        const std::vector<Column>& Writer::columns() const noexcept {
+            return mColumns;
+        }
+
+        Reader::Reader(const std::string& path) :
+            mFile(path, std::ios::binary) {
+            if (!mFile)
+                throw std::runtime_error("Cannot open " + path);
+            if (!read_header(mFile, mColumns))
+                throw std::runtime_error(path + " has no header");
+            mEnd.resize(mColumns.size());
+            mAt.resize(mColumns.size());
+            mLast.resize(mColumns.size());
+        }
+
+        const std::vector<Column>& Reader::columns() const noexcept {
+            return mColumns;
+        }
+
+        int Reader::find(const std::string& name) const noexcept {
+            for (std::size_t c = 0; c < mColumns.size(); c++) {
+                if (mColumns[c].name == name)
+                    return c;
+            }
+            return -1;
+        }
+
+        bool Reader::load() {
+            std::uint32_t rows;
+            if (!get(mFile, rows))
+                return false;
+            std::size_t total = 0;
+            for (std::size_t c = 0; c < mColumns.size(); c++) {
+                std::uint32_t size;
+                if (!get(mFile, size))
+                    return false;
+                mAt[c] = total;
+                total += size;
+                mEnd[c] = total;
+            }
+            mBytes.resize(total);
+            if (!mFile.read(reinterpret_cast<char*>(mBytes.data()), total))
+                return false;
+            mLast.assign(mColumns.size(), 0);
+            mRows = rows;
+            mRow = 0;
+            return true;
+        }
+
+        bool Reader::next(std::uint64_t* values) {
+            while (mRow == mRows) {
+                if (!load())
+                    return false;
+            }
+            for (std::size_t c = 0; c < mColumns.size(); c++) {
+                std::uint64_t x;
+                if (!get_varint(mBytes, mAt[c], mEnd[c], x))
+                    throw std::runtime_error("A block ends within a row");
+                if (mColumns[c].encoding == Encoding::delta) {
+                    x = mLast[c] + (x >> 1 ^ -(x & 1));
+                    mLast[c] = x;
+                }
+                values[c] = x;
+            }
+            mRow++;
+            return true;
+        }
+    } // namespace results
+} // namespace Holy
@@ -0,0 +1,113 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// @file results.h A compact store of a row per game, for long benchmark runs
+/// A file is a header naming its columns, then blocks of up to block_rows
+/// rows. A block stores each column on its own, every value as a LEB128
+/// varint, so small counts take a byte and the rows of a million games a
+/// few megabytes. Integers outside the varints are in native byte order.
+///
+/// Header: "HOLYRES1", a uint32 column count, then per column its Encoding
+/// as a byte, the length of its name as a byte and the name.
+/// Block: a uint32 row count, a uint32 byte count per column, then the
+/// bytes of each column in the order of the header.
+
+namespace Holy {
+    namespace results {
+        /// @brief How the values of a column are turned into varints
+        enum class Encoding : std::uint8_t {
+            /// As they are
+            plain = 0,
+            /// The difference from the row before in the block, zigzag
+            /// encoded, for columns that go up by a little each row
+            delta = 1
+        };
+
+        struct Column {
+            std::string name;
+            Encoding encoding = Encoding::plain;
+        };
+
+        /// @brief Most rows in a block
+        constexpr int block_rows = 4096;
+
+        /// @brief Appends rows to a file, a block at a time
+        class Writer {
+        public:
+            /// @brief Appends to the file at path, which gets a header of
+            /// columns if it is new or empty
+            /// @exception std::runtime_error if the file cannot be opened,
+            /// or has other columns
+            Writer(const std::string& path, std::vector<Column> columns);
+
+            // Copy operations are not permitted.
+            Writer(const Writer& src) = delete;
+
+            // Copy operations are not permitted.
+            Writer& operator=(const Writer& src) = delete;
+
+            /// @brief Writes the rows not written yet, if it can
+            ~Writer() noexcept;
+
+            /// @brief Adds a row, writing a block if block_rows are waiting
+            /// @param values -- a value per column, in the order of the
+            /// header
+            /// @exception std::runtime_error if the file cannot be written
+            void add(const std::uint64_t* values);
+
+            /// @brief Writes the rows added since the last block as a block
+            /// @exception std::runtime_error if the file cannot be written
+            void flush();
+
+            const std::vector<Column>& columns() const noexcept;
+
+        private:
+            std::ofstream mFile;
+            std::vector<Column> mColumns;
+            // The encoded values of each column, and its last value
+            std::vector<std::vector<std::uint8_t>> mBytes;
+            std::vector<std::uint64_t> mLast;
+            int mRows = 0;
+        };
+
+        /// @brief Reads the rows of a file one at a time, a block in memory
+        /// A block cut short, as by a run that was killed, ends the file.
+        class Reader {
+        public:
+            /// @exception std::runtime_error if the file cannot be opened or
+            /// does not start with a header
+            explicit Reader(const std::string& path);
+
+            const std::vector<Column>& columns() const noexcept;
+
+            /// @returns the index of the column called name, or -1
+            int find(const std::string& name) const noexcept;
+
+            /// @brief Reads the next row
+            /// @param values -- room for a value per column
+            /// @returns false at the end of the file
+            /// @exception std::runtime_error if a block is malformed
+            bool next(std::uint64_t* values);
+
+        private:
+            // Reads the next block, returns false if there is none
+            bool load();
+
+            std::ifstream mFile;
+            std::vector<Column> mColumns;
+            // The bytes of the current block, where each column starts in
+            // them and where it is read up to, and its last value
+            std::vector<std::uint8_t> mBytes;
+            std::vector<std::size_t> mEnd, mAt;
+            std::vector<std::uint64_t> mLast;
+            int mRows = 0, mRow = 0;
+        };
+    } // namespace results
+} // namespace Holy
+
+#endif // RESULTS_H
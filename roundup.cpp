@@ -1,4 +1,5 @@
 #include "solvers.h"
+#include <array>
 #include <cassert>
 
 namespace Holy {
@@ -8,26 +9,20 @@ namespace Holy {
                 return false;
             if (game[p].vacant_nei == 0)
                 return false;
-            if (game[p].vacant_nei == game[p].elabel) {
-                p.for_each_nei8([&](Point np) {
-                    // mark a mine if this is vacant
-                    if (game[np].status == Block::unknown) {
-                        game.mark_mine(np);
-                        // Butterfly doesn't support right click
-                    }
-                });
-                return true;
-            }
-            if (game[p].elabel == 0) {
-                p.for_each_nei8([&](Point np) {
-                    // mark a number if it is vacant,
-                    // recounting done in accio
-                    if (game[np].status == Block::unknown)
-                        game.mark_semiknown(np);
-                });
-                return true;
-            }
-            return false;
+            // All vacant neighbors are mines, or all are numbers
+            const bool mine = game[p].vacant_nei == game[p].elabel;
+            if (!mine && game[p].elabel != 0)
+                return false;
+            // Butterfly doesn't support right click, and numbers are
+            // recounted in accio
+            std::array<Mark, 8> marks;
+            int n = 0;
+            game.for_each_nei8(p, [&](Point np) {
+                if (game[np].status == Block::unknown)
+                    marks[n++] = { np, mine };
+            });
+            game.mark_batch(marks.data(), n);
+            return true;
         }
     } // namespace
 
@@ -0,0 +1,50 @@
+#ifndef RUNNING_H
+#define RUNNING_H
+
+#include <cmath>
+#include <ostream>
+
+/// @file running.h Confidence intervals for the benchmarks
+/// The benchmarks play configurations on the same seeded layouts and
+/// report the mean of a sample, or of the differences game by game, with
+/// its 95% confidence interval.
+
+namespace Holy {
+    /// @brief Mean and variance of a sample, updated one value at a time
+    /// (Welford)
+    struct Running {
+        long long n = 0;
+        double mean = 0, m2 = 0;
+
+        void add(double x) {
+            n++;
+            const double d = x - mean;
+            mean += d / n;
+            m2 += d * (x - mean);
+        }
+
+        /// @returns half the width of the 95% confidence interval of the
+        /// mean, infinite until there are two values
+        double half_width() const {
+            return n < 2 ? HUGE_VAL : 1.96 * std::sqrt(m2 / (n - 1) / n);
+        }
+
+        /// @returns the two-sided p-value of the mean being 0
+        double p_value() const {
+            if (n < 2)
+                return 1;
+            const double se = half_width() / 1.96;
+            if (se == 0)
+                return mean == 0 ? 1 : 0;
+            return std::erfc(std::abs(mean) / se / std::sqrt(2.0));
+        }
+    };
+
+    /// @brief Writes what, then the mean of r and its interval
+    inline void write_interval(
+        std::ostream& out, const char* what, const Running& r) {
+        out << what << r.mean << " +- " << r.half_width();
+    }
+} // namespace Holy
+
+#endif // RUNNING_H
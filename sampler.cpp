@@ -0,0 +1,250 @@
+#include "solvers.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+namespace {
+    using namespace Holy;
+
+    // A number block seen from the frontier.
+    // The mines among its frontier neighbors must stay within [lo, hi]
+    struct Constraint {
+        int lo = 0, hi = 0;
+        // Indices into the frontier
+        std::vector<int> cells;
+    };
+
+    // The frontier compiled into plain indices, shared read-only by workers
+    struct Model {
+        std::vector<Constraint> cons;
+        // Constraints touching each frontier cell
+        std::vector<std::vector<int>> cell_cons;
+        int mines_left = 0;
+    };
+
+    Model compile(const GameData& game, const Frontier& front) {
+        Model m;
+        m.mines_left = game.mines_left;
+        const int n = front.size();
+        std::array<int, hash_max> index;
+        index.fill(-1);
+        for (int i = 0; i < n; i++)
+            index[front[i].hash()] = i;
+        m.cell_cons.resize(n);
+        // Number blocks already turned into constraints
+        Checklist seen;
+        for (const auto& p : front) {
+            game.for_each_nei8(p, [&](Point np) {
+                const Block& nb = game[np];
+                if (nb.status != Block::number || !nb.second_init)
+                    return;
+                if (seen[np.hash()])
+                    return;
+                seen[np.hash()] = true;
+                Constraint c;
+                // Unknown neighbors that are not in the frontier can absorb
+                // some of the label, so only the upper bound is tight
+                int outside = 0;
+                game.for_each_nei8(np, [&](Point q) {
+                    if (game[q].status != Block::unknown)
+                        return;
+                    if (index[q.hash()] >= 0)
+                        c.cells.push_back(index[q.hash()]);
+                    else
+                        outside++;
+                });
+                c.hi = nb.elabel;
+                c.lo = std::max(0, nb.elabel - outside);
+                const int id = m.cons.size();
+                for (int v : c.cells)
+                    m.cell_cons[v].push_back(id);
+                m.cons.push_back(std::move(c));
+            });
+        }
+        return m;
+    }
+
+    using Rng = std::mt19937_64;
+
+    // Draws random assignments of the frontier in frontier order, choosing
+    // uniformly among the values that keep every constraint satisfiable.
+    // An assignment drawn this way has probability 1 / weight, where weight
+    // is the product of the number of choices at each step, so weighting it
+    // by weight makes the estimate uniform over consistent assignments.
+    struct Walker {
+        const Model& m;
+        std::vector<char> mined;
+        // Mines placed around each constraint
+        std::vector<int> load;
+        // Unassigned cells around each constraint
+        std::vector<int> open;
+        int total = 0;
+
+        explicit Walker(const Model& model) :
+            m(model),
+            mined(model.cell_cons.size(), 0),
+            load(model.cons.size(), 0),
+            open(model.cons.size(), 0) {}
+
+        // Whether v can take val with the constraints still satisfiable
+        bool fits(int v, int val) const {
+            if (total + val > m.mines_left)
+                return false;
+            for (int c : m.cell_cons[v]) {
+                if (load[c] + val > m.cons[c].hi)
+                    return false;
+                if (load[c] + val + open[c] - 1 < m.cons[c].lo)
+                    return false;
+            }
+            return true;
+        }
+
+        // Returns the weight of the assignment left in mined,
+        // or 0 if the walk ran into a dead end
+        double draw(Rng& rng) {
+            const int n = mined.size();
+            std::fill(load.begin(), load.end(), 0);
+            for (int c = 0; c < (int)m.cons.size(); c++)
+                open[c] = m.cons[c].cells.size();
+            total = 0;
+            double weight = 1;
+            for (int v = 0; v < n; v++) {
+                const bool safe = fits(v, 0), mine = fits(v, 1);
+                int val;
+                if (safe && mine) {
+                    weight *= 2;
+                    val = rng() & 1;
+                } else if (safe || mine)
+                    val = mine;
+                else
+                    return 0;
+                mined[v] = val;
+                total += val;
+                for (int c : m.cell_cons[v]) {
+                    load[c] += val;
+                    open[c]--;
+                }
+            }
+            return weight;
+        }
+    };
+
+    // Per-worker sums, merged after all workers join
+    struct Tally {
+        // Sum of weights, and of weights of walks with a mine on each cell
+        double weight = 0;
+        std::vector<double> hits;
+        // The same with squared weights, for the error estimate
+        double weight2 = 0;
+        std::vector<double> hits2;
+        // Walks made, including dead ends
+        long long walks = 0;
+    };
+
+    void worker(
+        const Model& m,
+        const SamplerConfig& config,
+        unsigned stream,
+        long long quota,
+        std::chrono::steady_clock::time_point deadline,
+        Tally& tally) {
+        const int n = m.cell_cons.size();
+        std::seed_seq seq{ config.seed, stream };
+        Rng rng(seq);
+        tally.hits.assign(n, 0);
+        tally.hits2.assign(n, 0);
+        Walker walker(m);
+        const auto& mine_weights = config.mine_weights;
+        while (tally.walks < quota) {
+            // Reading the clock is not free, check it once in a while
+            if (config.budget.count() > 0 && tally.walks % 64 == 0
+                && std::chrono::steady_clock::now() >= deadline)
+                break;
+            tally.walks++;
+            double w = walker.draw(rng);
+            if (w != 0 && !mine_weights.empty()) {
+                w *= walker.total < (int)mine_weights.size()
+                    ? mine_weights[walker.total]
+                    : 0;
+            }
+            if (w == 0)
+                continue;
+            tally.weight += w;
+            tally.weight2 += w * w;
+            for (int v = 0; v < n; v++) {
+                if (walker.mined[v]) {
+                    tally.hits[v] += w;
+                    tally.hits2[v] += w * w;
+                }
+            }
+        }
+    }
+} // namespace
+
+namespace Holy {
+    ChanceEstimate sample_front(
+        const GameData& game,
+        const Frontier& front,
+        const SamplerConfig& config) {
+        ChanceEstimate est;
+        est.chance.fill(0);
+        est.low.fill(0);
+        est.high.fill(0);
+        if (front.empty())
+            return est;
+        const Model m = compile(game, front);
+        const int n = front.size();
+        int threads = config.threads;
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        const auto deadline = std::chrono::steady_clock::now() + config.budget;
+        const long long quota = (config.samples + threads - 1) / threads;
+        std::vector<Tally> tallies(threads);
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; t++) {
+            pool.emplace_back(
+                worker,
+                std::cref(m),
+                std::cref(config),
+                t,
+                quota,
+                deadline,
+                std::ref(tallies[t]));
+        }
+        worker(m, config, 0, quota, deadline, tallies[0]);
+        for (auto& th : pool)
+            th.join();
+        // Merge the tallies
+        Tally all;
+        all.hits.assign(n, 0);
+        all.hits2.assign(n, 0);
+        for (const auto& tally : tallies) {
+            all.weight += tally.weight;
+            all.weight2 += tally.weight2;
+            all.walks += tally.walks;
+            for (int v = 0; v < n; v++) {
+                all.hits[v] += tally.hits[v];
+                all.hits2[v] += tally.hits2[v];
+            }
+        }
+        est.samples = all.walks;
+        if (all.weight == 0)
+            return est;
+        for (int v = 0; v < n; v++) {
+            const double p = all.hits[v] / all.weight;
+            // Variance of the self-normalized estimate,
+            // sum of w^2 (x - p)^2 / (sum of w)^2 with x either 0 or 1
+            const double var =
+                (all.hits2[v] * (1 - 2 * p) + p * p * all.weight2)
+                / (all.weight * all.weight);
+            const double se = std::sqrt(std::max(0.0, var));
+            const int h = front[v].hash();
+            est.chance[h] = p;
+            est.low[h] = std::max(0.0, p - config.z * se);
+            est.high[h] = std::min(1.0, p + config.z * se);
+        }
+        return est;
+    }
+} // namespace Holy
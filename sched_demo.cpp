@@ -1,7 +1,9 @@
 // Contains main()
 // Demonstrates how the program runs, and tests accio
-#include "solvers.h"
+#include "scheduler.h"
+#include "trace.h"
 #include <chrono>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
 
@@ -17,12 +19,13 @@ void print(const GameData& game) {
                     std::cout << ' ';
                     break;
                 case Block::number:
-                    std::cout << b.label;
+                    std::cout << (int)b.label;
                     break;
                 case Block::mine:
                     std::cout << '*';
                     break;
                 case Block::semiknown:
+                case Block::border:
                     std::cerr << "Shouldn't have appeared!\n";
                     std::terminate();
             }
@@ -46,7 +49,11 @@ void print(const MineChance& mc) {
     }
 }
 
-void main_loop(Butterfly& butt) {
+void main_loop(Butterfly& butt, Scheduler& sched, const Advice& advice) {
+    // HOLY_TRACE names a file that gets the timeline of the last game
+    const char* trace_path = std::getenv("HOLY_TRACE");
+    if (trace_path)
+        trace::start(trace_path);
     GameData game;
     // std::cerr << "Start first click\n";
     butt.start_game({ 10, 10 });
@@ -56,43 +63,31 @@ void main_loop(Butterfly& butt) {
     // std::cerr << "Finished initial accio\n";
     std::cout << "Intial position:\n";
     print(game);
-    bool has_hope;
-    do {
-        // std::cerr << "Has hope\n";
-        has_hope = false;
-        while (roundup(game)) {
-            has_hope = true;
-            accio(game, butt, true);
-        }
-        while (felix(game)) {
-            has_hope = true;
-            accio(game, butt, true);
-        }
-    } while (has_hope);
+    const int john_stage = sched.find("john");
+    const long long john_runs = sched.stats(john_stage).runs;
+    std::cout << "Blocks resolved: " << sched.solve(game, butt) << '\n';
+    if (trace_path)
+        trace::stop();
     std::cout << "Whether butterfly says we win: " << butt.verify() << std::endl;
-    if (butt.verify())
-        return;
-    std::cout << "Invoking john" << std::endl;
-    while (true) {
-        auto [guess, mc] = john(game);
-        if (mc) {
-            // No longer deterministic, break
-            std::cout << "Whether john was deterministic: " << (!mc) << '\n';
-            std::cout << "Whether butterfly says we win: " << butt.verify() << '\n';
-            std::cout << "Whether john says we guess: " << guess << std::endl;
-            break;
-        }
-        roundup(game);
-        accio(game, butt, true);
+    if (sched.stats(john_stage).runs > john_runs)
+        std::cout << "Whether john says we guess: " << advice.guess << '\n';
+    for (int i = 0; i < sched.size(); i++) {
+        const auto& st = sched.stats(i);
+        std::cout << sched.stage(i).name << ": runs " << st.runs << ", fired "
+                  << st.fired << ", skipped " << st.skipped << ", "
+                  << st.nanoseconds / 1000 << "us\n";
     }
     print(game);
 }
 
 int main() {
     Butterfly butt;
+    Scheduler sched;
+    Advice advice;
+    add_solvers(sched, advice);
     std::cout << std::boolalpha;
     while (true) {
-        main_loop(butt);
+        main_loop(butt, sched, advice);
         std::cin.get();
     }
 }
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "scheduler.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+    using namespace Holy;
+
+    // Unknown blocks left on the board
+    int count_unknown(const GameData& game) noexcept {
+        int ret = 0;
+        for (const auto& block : game.blocks)
+            ret += block.status == Block::unknown;
+        return ret;
+    }
+
+    // Whether a number within distance radius of a changed block satisfies
+    // pred. Starts from whichever side is smaller: the changed blocks, or
+    // all numbers on the board.
+    template <typename Pred>
+    bool near_changed(
+        const GameData& game,
+        const Checklist& changed,
+        int radius,
+        Pred&& pred) {
+        const int area = (2 * radius + 1) * (2 * radius + 1);
+        const bool from_changed = (int)changed.count() * area < col * row;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                if (from_changed) {
+                    if (!changed[Point{ ix, iy }.hash()])
+                        continue;
+                } else {
+                    const Block& b = game[{ ix, iy }];
+                    if (b.status != Block::number || !b.second_init
+                        || !pred(b))
+                        continue;
+                }
+                for (int dx = -radius; dx <= radius; dx++) {
+                    for (int dy = -radius; dy <= radius; dy++) {
+                        const Point np{ ix + dx, iy + dy };
+                        if (!np.valid())
+                            continue;
+                        if (!from_changed) {
+                            if (changed[np.hash()])
+                                return true;
+                            continue;
+                        }
+                        const Block& b = game[np];
+                        if (b.status == Block::number && b.second_init
+                            && pred(b))
+                            return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // roundup() fires on a number whose vacant neighbors are all mines or
+    // all safe. Its elabel and vacant_nei only change with its neighbors.
+    bool roundup_can_fire(const GameData& game, const Checklist& changed) {
+        return near_changed(game, changed, 1, [](const Block& b) {
+            return b.vacant_nei > 0
+                && (b.elabel == 0 || b.elabel == b.vacant_nei);
+        });
+    }
+
+    // felix() looks at a center with elabel 1 and the numbers within 2 of
+    // it, which depend on the blocks within 1 of them.
+    bool felix_can_fire(const GameData& game, const Checklist& changed) {
+        return near_changed(game, changed, 3, [](const Block& b) {
+            return b.elabel == 1 && b.vacant_nei > 0;
+        });
+    }
+
+    // window() looks at pairs of numbers within 2 of each other, which
+    // depend on the blocks within 1 of either.
+    bool window_can_fire(const GameData& game, const Checklist& changed) {
+        return near_changed(game, changed, 3, [](const Block& b) {
+            return b.vacant_nei > 0;
+        });
+    }
+
+    // john() depends on mines_left, so any change may matter, but there has
+    // to be a frontier: a number with a vacant neighbor. Near the end,
+    // endgame() can move without one, on mines_left alone.
+    bool john_can_fire(const GameData& game, const Checklist&) {
+        int unknown = 0;
+        for (const auto& block : game.blocks) {
+            if (block.status == Block::number && block.vacant_nei > 0)
+                return true;
+            unknown += block.status == Block::unknown;
+        }
+        return unknown > 0 && unknown <= endgame_max_cells;
+    }
+} // namespace
+
+namespace Holy {
+    Scheduler::Scheduler(Policy policy) : mPolicy(policy) {
+        mSnapshot.fill(Block::unknown);
+    }
+
+    void Scheduler::add(Stage stage) {
+        mTraceNames.push_back(trace::intern(stage.name));
+        mStages.push_back(std::move(stage));
+        mStats.emplace_back();
+        mDirty.emplace_back();
+        mHot.push_back(false);
+        mOrder.resize(mStages.size());
+    }
+
+    int Scheduler::size() const noexcept {
+        return mStages.size();
+    }
+
+    const Scheduler::Stage& Scheduler::stage(int i) const {
+        return mStages.at(i);
+    }
+
+    const Scheduler::Stats& Scheduler::stats(int i) const {
+        return mStats.at(i);
+    }
+
+    void Scheduler::count_events(const perf::Counters* counters) noexcept {
+        mCounters = counters;
+    }
+
+    const Scheduler::Stats& Scheduler::accio_stats() const noexcept {
+        return mAccio;
+    }
+
+    int Scheduler::find(const std::string& name) const noexcept {
+        for (int i = 0; i < size(); i++) {
+            if (mStages[i].name == name)
+                return i;
+        }
+        return -1;
+    }
+
+    int Scheduler::pick(const GameData& game) {
+        // Stages that changed blocks may have woken up, best first.
+        // Stages never run go first, in order.
+        auto& order = mOrder;
+        int cnt = 0;
+        for (int i = 0; i < size(); i++) {
+            if (mDirty[i].none())
+                continue;
+            const Stats& st = mStats[i];
+            // Blocks resolved per nanosecond, with one block in a
+            // microsecond as the prior
+            const double score = st.runs == 0
+                ? HUGE_VAL
+                : (st.progress + 1.0) / (st.nanoseconds + 1000.0);
+            order[cnt++] = { -score, i };
+        }
+        std::stable_sort(order.begin(), order.begin() + cnt);
+        // Only ask can_fire as far down the list as needed. A stage whose
+        // last run made a move usually makes another, so it isn't asked.
+        for (int k = 0; k < cnt; k++) {
+            const int i = order[k].second;
+            const Stage& s = mStages[i];
+            if (mHot[i] || !s.can_fire || s.can_fire(game, mDirty[i]))
+                return i;
+            mStats[i].skipped++;
+            // Nothing it can do until something else moves
+            mDirty[i].reset();
+        }
+        return -1;
+    }
+
+    bool Scheduler::step(int i, GameData& game, GameBackend* backend) {
+        using namespace std::chrono;
+        const trace::Span span(mTraceNames[i]);
+        Stats& st = mStats[i];
+        const auto start = steady_clock::now();
+        const perf::Sample start_events =
+            mCounters ? mCounters->read() : perf::Sample();
+        const int before = count_unknown(game);
+        const bool fired = mStages[i].run(game);
+        if (mCounters)
+            st.events += mCounters->read() - start_events;
+        if (fired && backend) {
+            const auto accio_start = steady_clock::now();
+            const perf::Sample accio_events =
+                mCounters ? mCounters->read() : perf::Sample();
+            accio(game, *backend, true);
+            if (mCounters)
+                mAccio.events += mCounters->read() - accio_events;
+            mAccio.runs++;
+            mAccio.nanoseconds +=
+                duration_cast<nanoseconds>(steady_clock::now() - accio_start)
+                    .count();
+        }
+        const auto end = steady_clock::now();
+        st.runs++;
+        st.nanoseconds += duration_cast<nanoseconds>(end - start).count();
+        mHot[i] = fired;
+        if (!fired) {
+            mDirty[i].reset();
+            return false;
+        }
+        st.fired++;
+        st.progress += before - count_unknown(game);
+        // Let every stage know which blocks changed
+        Checklist changed;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point p{ ix, iy };
+                if (game[p].status != mSnapshot[p.index()]) {
+                    changed[p.hash()] = true;
+                    mSnapshot[p.index()] = game[p].status;
+                }
+            }
+        }
+        for (auto& dirty : mDirty)
+            dirty |= changed;
+        return true;
+    }
+
+    int Scheduler::solve(GameData& game, GameBackend& backend) {
+        return run(game, &backend);
+    }
+
+    int Scheduler::solve(GameData& game) {
+        return run(game, nullptr);
+    }
+
+    int Scheduler::run(GameData& game, GameBackend* backend) {
+        const int before = count_unknown(game);
+        for (std::size_t i = 0; i < mSnapshot.size(); i++)
+            mSnapshot[i] = game.blocks[i].status;
+        for (auto& dirty : mDirty)
+            dirty.set();
+        mHot.assign(size(), false);
+        if (mPolicy == Policy::fixed) {
+            for (int i = 0; i < size();)
+                i = step(i, game, backend) ? 0 : i + 1;
+        } else {
+            for (int i; (i = pick(game)) >= 0;)
+                step(i, game, backend);
+        }
+        return before - count_unknown(game);
+    }
+
+    void add_solvers(Scheduler& sched, Advice& advice, JohnCache* cache) {
+        sched.add({ "roundup", roundup, roundup_can_fire });
+        sched.add({ "window", window, window_can_fire });
+        sched.add({ "felix", felix, felix_can_fire });
+        sched.add({ "john", [&advice, cache](GameData& game) {
+                       auto [guess, mc] =
+                           cache ? john(game, *cache) : john(game);
+                       if (!mc)
+                           return true;
+                       advice = { guess, std::move(mc) };
+                       return false;
+                   },
+            john_can_fire });
+    }
+} // namespace Holy
@@ -0,0 +1,140 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "perf.h"
+#include "solvers.h"
+#include <functional>
+#include <string>
+
+/// @file scheduler.h Decides which solver runs next
+/// Rather than a fixed "roundup until stuck, then felix, then john" loop,
+/// the Scheduler keeps a registry of stages and, at every step, runs the one
+/// that has so far resolved the most blocks per nanosecond among those that
+/// could make a move at all.
+
+namespace Holy {
+    /// @brief Runs solver stages on a game until none of them can move
+    class Scheduler {
+    public:
+        /// @brief How the next stage is chosen
+        enum class Policy {
+            /// Best measured blocks resolved per nanosecond, skipping
+            /// stages that cannot fire on what changed since their last run
+            adaptive,
+            /// The first stage in registration order that makes a move,
+            /// starting over from the first after every move
+            fixed
+        };
+
+        /// @brief A solver as seen by the scheduler
+        struct Stage {
+            std::string name;
+            /// Marks blocks as mine or semiknown,
+            /// returns true if it made a move
+            std::function<bool(GameData&)> run;
+            /// Whether run could make a move on game, given that the
+            /// blocks in changed (by hash) are the only ones whose status
+            /// changed since it last made none.
+            /// If empty, any change is taken to be enough.
+            std::function<bool(const GameData&, const Checklist&)> can_fire;
+        };
+
+        /// @brief What a stage has done so far
+        struct Stats {
+            /// Calls to run, and how many of those made a move
+            long long runs = 0, fired = 0;
+            /// Times the stage was passed over by can_fire
+            long long skipped = 0;
+            /// Unknown blocks resolved by its moves
+            long long progress = 0;
+            /// Time spent in run and in applying its moves
+            long long nanoseconds = 0;
+            /// Hardware events in run, while count_events() is on
+            perf::Sample events;
+        };
+
+        explicit Scheduler(Policy policy = Policy::adaptive);
+
+        /// @brief Adds a stage, ties are broken by the order of add()
+        void add(Stage stage);
+
+        /// @brief Runs stages on game and applies their moves through backend
+        /// with accio(), until no stage can make a move
+        /// @returns the number of unknown blocks resolved
+        /// @exception This function only transmits exceptions.
+        int solve(GameData& game, GameBackend& backend);
+
+        /// @brief Runs stages on game until no stage can make a move, with
+        /// nothing to click: the moves stay on game, as semiknown and mine
+        /// blocks, for later stages to build on
+        /// @returns the number of unknown blocks resolved
+        /// @exception This function only transmits exceptions.
+        int solve(GameData& game);
+
+        /// @returns the number of stages
+        int size() const noexcept;
+
+        /// @returns the stage added i-th
+        const Stage& stage(int i) const;
+
+        /// @returns the stats of the stage added i-th, summed over all calls
+        /// to solve()
+        const Stats& stats(int i) const;
+
+        /// @returns the index of the first stage called name, -1 if none
+        int find(const std::string& name) const noexcept;
+
+        /// @brief Reads counters around every run of a stage and every
+        /// accio(), into Stats::events and accio_stats(); nullptr stops
+        /// @param counters -- of the thread calling solve(), must outlive
+        /// their use
+        void count_events(const perf::Counters* counters) noexcept;
+
+        /// @returns the calls to accio() by solve(game, backend) as runs,
+        /// the time in them and, while count_events() is on, their events
+        const Stats& accio_stats() const noexcept;
+
+    private:
+        // Index of the next stage to run in adaptive mode, -1 if none can
+        // fire, counting the ones skipped
+        int pick(const GameData& game);
+
+        // Runs stage i and applies its moves through backend unless it is
+        // nullptr, updating its stats
+        bool step(int i, GameData& game, GameBackend* backend);
+
+        // Both versions of solve()
+        int run(GameData& game, GameBackend* backend);
+
+        Policy mPolicy;
+        std::vector<Stage> mStages;
+        // Names of the stages for trace::Span
+        std::vector<const char*> mTraceNames;
+        std::vector<Stats> mStats;
+        Stats mAccio;
+        const perf::Counters* mCounters = nullptr;
+        // Blocks changed since stage i last made no move
+        std::vector<Checklist> mDirty;
+        // Whether the last run of stage i made a move
+        std::vector<bool> mHot;
+        // Scratch of pick(): (-score, stage)
+        std::vector<std::pair<double, int>> mOrder;
+        // Status of every block after the last move
+        std::array<Block::Status, board_size> mSnapshot;
+    };
+
+    /// @brief What john() advised when it last made no move
+    struct Advice {
+        bool guess = false;
+        std::optional<MineChance> chance;
+    };
+
+    /// @brief Registers roundup(), window(), felix() and john(), in that
+    /// order
+    /// @param advice -- receives the result of john() whenever it makes no
+    /// move, must outlive sched
+    /// @param cache -- the cache for john(), its thread's own if nullptr
+    void add_solvers(Scheduler& sched, Advice& advice, JohnCache* cache = nullptr);
+} // namespace Holy
+
+#endif // SCHEDULER_H
@@ -0,0 +1,242 @@
+// Contains main()
+// Solves positions for any number of clients on a fixed pool of threads
+// Usage: solve_daemon <socket> [threads] [queue]
+//     threads -- solver threads, one per hardware thread by default
+//     queue   -- requests waiting for a thread before clients are made to
+//                wait, 256 by default
+// Each client connection has a reader thread that parses requests into the
+// queue, and a writer thread that sends the answers. Solver threads take up
+// to batch_max requests at a time and hand the answers to one client to its
+// writer in one go, so a client that stops reading holds up only its own
+// threads.
+#include "analysis.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace Holy;
+
+// Most requests a solver thread takes from the queue at a time
+constexpr int batch_max = 16;
+
+// Most requests of a client that may be queued, being solved or waiting to
+// be written before its reader stops reading
+constexpr int pending_max = 64;
+
+// A client, closed when its reader, its writer and the last of its requests
+// are done
+class Connection {
+public:
+    explicit Connection(int fd) noexcept : fd(fd) {}
+
+    ~Connection() noexcept {
+        ::close(fd);
+    }
+
+    const int fd;
+
+    // Counts a request read from the client, waiting while pending_max are
+    // pending. Returns false if the writer gave up on the client.
+    bool reserve() {
+        std::unique_lock lock(mMutex);
+        mChanged.wait(
+            lock, [this] { return mPending < pending_max || mBroken; });
+        if (mBroken)
+            return false;
+        mPending++;
+        return true;
+    }
+
+    // No more requests will be read
+    void close_input() {
+        {
+            std::lock_guard lock(mMutex);
+            mInputDone = true;
+        }
+        mChanged.notify_all();
+    }
+
+    // Hands the answers to n requests to the writer
+    void send(std::vector<char> answers, int n) {
+        {
+            std::lock_guard lock(mMutex);
+            mOutbox.emplace_back(std::move(answers), n);
+        }
+        mChanged.notify_all();
+    }
+
+    // Body of the writer thread: writes the answers in the order they were
+    // sent, until the input is done and nothing is pending. After a failed
+    // write, answers are dropped and the reader is woken up by a shutdown.
+    void write_answers() {
+        std::unique_lock lock(mMutex);
+        while (true) {
+            mChanged.wait(lock, [this] {
+                return !mOutbox.empty() || (mInputDone && mPending == 0);
+            });
+            if (mOutbox.empty())
+                return;
+            auto [answers, n] = std::move(mOutbox.front());
+            mOutbox.pop_front();
+            const bool broken = mBroken;
+            lock.unlock();
+            const bool ok = broken
+                || wire::write_all(fd, answers.data(), answers.size());
+            if (!ok)
+                ::shutdown(fd, SHUT_RDWR);
+            lock.lock();
+            mBroken = !ok || broken;
+            mPending -= n;
+            mChanged.notify_all();
+        }
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+    // Answers not written yet, and the number of requests they answer
+    std::deque<std::pair<std::vector<char>, int>> mOutbox;
+    int mPending = 0;
+    bool mInputDone = false, mBroken = false;
+};
+
+struct Job {
+    std::shared_ptr<Connection> from;
+    query::Request request;
+};
+
+// Requests waiting for a solver thread
+// push() blocks while it is full, so a client that sends faster than the
+// pool solves stops being read, and its writes block in turn. A client that
+// does not read its answers stops being read at pending_max.
+class JobQueue {
+public:
+    explicit JobQueue(std::size_t capacity) : mCapacity(capacity) {}
+
+    void push(Job job) {
+        std::unique_lock lock(mMutex);
+        mNotFull.wait(lock, [this] { return mJobs.size() < mCapacity; });
+        mJobs.push_back(std::move(job));
+        lock.unlock();
+        mNotEmpty.notify_one();
+    }
+
+    // Moves up to max jobs to out, waiting for at least one
+    void pop(std::vector<Job>& out, int max) {
+        std::unique_lock lock(mMutex);
+        mNotEmpty.wait(lock, [this] { return !mJobs.empty(); });
+        while (!mJobs.empty() && (int)out.size() < max) {
+            out.push_back(std::move(mJobs.front()));
+            mJobs.pop_front();
+        }
+        lock.unlock();
+        mNotFull.notify_all();
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mNotFull, mNotEmpty;
+    std::deque<Job> mJobs;
+    const std::size_t mCapacity;
+};
+
+// Body of a solver thread, with its own analyst and john cache
+void solver(JobQueue& queue) {
+    Analyst analyst;
+    std::vector<Job> batch;
+    std::vector<char> buf;
+    while (true) {
+        batch.clear();
+        queue.pop(batch, batch_max);
+        // Requests of a client are usually next to each other
+        for (std::size_t i = 0; i < batch.size();) {
+            const auto& conn = batch[i].from;
+            buf.clear();
+            int n = 0;
+            for (; i < batch.size() && batch[i].from == conn; i++, n++)
+                analyst.answer(batch[i].request, buf);
+            conn->send(std::move(buf), n);
+        }
+    }
+}
+
+// Body of the reader thread of a client
+void reader(std::shared_ptr<Connection> conn, JobQueue& queue) {
+    Job job{ conn, {} };
+    while (query::receive(conn->fd, job.request) && conn->reserve())
+        queue.push(job);
+    conn->close_input();
+}
+
+// Body of the writer thread of a client
+void writer(std::shared_ptr<Connection> conn) {
+    conn->write_answers();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: solve_daemon <socket> [threads] [queue]\n";
+        return 1;
+    }
+    const int threads = argc > 2
+        ? std::atoi(argv[2])
+        : (int)std::max(1u, std::thread::hardware_concurrency());
+    const int capacity = argc > 3 ? std::atoi(argv[3]) : 256;
+    if (threads < 1 || capacity < 1) {
+        std::cerr << "threads and queue should be positive\n";
+        return 1;
+    }
+    // A client going away shows up as a failed write instead
+    std::signal(SIGPIPE, SIG_IGN);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(argv[1]) >= sizeof addr.sun_path) {
+        std::cerr << "Socket path too long\n";
+        return 1;
+    }
+    std::strcpy(addr.sun_path, argv[1]);
+    ::unlink(argv[1]);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0
+        || ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0
+        || ::listen(fd, 64) < 0) {
+        std::cerr << "Cannot listen on " << argv[1] << '\n';
+        return 1;
+    }
+    JobQueue queue(capacity);
+    for (int t = 0; t < threads; t++)
+        std::thread(solver, std::ref(queue)).detach();
+    std::cerr << "Solving on " << threads << " threads\n";
+    while (true) {
+        const int client = ::accept(fd, nullptr, nullptr);
+        if (client < 0) {
+            // Out of descriptors or memory: wait for connections to close
+            // rather than spin
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS
+                || errno == ENOMEM) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            // A signal, or a client that gave up before it was accepted
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO)
+                continue;
+            std::cerr << "Cannot accept: " << std::strerror(errno) << '\n';
+            return 1;
+        }
+        auto conn = std::make_shared<Connection>(client);
+        std::thread(writer, conn).detach();
+        std::thread(reader, std::move(conn), std::ref(queue)).detach();
+    }
+}
@@ -2,6 +2,11 @@
 #define SOLVERS_H
 
 #include "butterfly.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
 #include <vector>
 
 // Because now reading and solving costs nothing, we can directly
@@ -12,8 +17,9 @@
 
 namespace Holy {
     /// @brief A list of blocks that are the frontier
+    /// Solvers build theirs in an Arena (see arena.h)
     /// FIXME: roundup and felix should have frontier versions as well
-    using Frontier = std::vector<Point>;
+    using Frontier = std::pmr::vector<Point>;
 
     /// @brief Deterministic solver
     /// For all blocks with neighbors either all empty or all mined,
@@ -40,25 +46,142 @@ namespace Holy {
     /// @warning Terminates when an unexpected bad move is taken.
     bool felix(GameData& game);
 
-    /// @brief Helper to transfer data from butterfly
+    /// @brief Deterministic solver
+    ///
+    /// For all pairs of numbers within distance 2, looks up what their
+    /// effective labels and shared vacant blocks force in a table built at
+    /// compile time, and marks it. This finds the 1-2 and 1-1 patterns and
+    /// whatever else two numbers tell without a search.
+    /// @param game -- the game data structure
+    /// @returns true if this call made a difference,
+    /// @returns false otherwise.
+    /// @exception This function only transmits exceptions.
+    bool window(GameData& game);
+
+    /// @brief Helper to transfer data from the game backend
     ///
     /// After the solver has made up its about mind which blocks to probe, it
     /// will call mark_semiknown() and mark_mine(), which maintains the satellite
     /// data for blocks already probed. This function's job is to get data from
-    /// butterfly, making sure the newly appeared blocks' recount() called, and
+    /// the backend, making sure the newly appeared blocks' recount() called, and
     /// new continents are handled correctly.
+    /// All semiknown blocks are clicked in a single batch, so this makes one
+    /// round trip to the backend.
     /// @param game -- the game data with semiknown blocks
-    /// @param butt -- the butterfly
+    /// @param backend -- the game, such as a Butterfly
     /// @param det -- whether the caller is determinisic
     /// @returns true if not lost, false if lost (det == false)
     /// @returns true (det == true)
     /// @exception This function only transmits exceptions.
     /// @warning Contains asserts that cause program to crash.
-    bool accio(GameData& game, Butterfly& butt, bool det);
+    bool accio(GameData& game, GameBackend& backend, bool det);
+
+    /// @brief The first half of accio(): the semiknown blocks of game,
+    /// in x then y order
+    /// @param batch -- room for col * row points
+    /// @returns the number of points written to batch
+    int accio_batch(const GameData& game, Point* batch) noexcept;
+
+    /// @brief The second half of accio(): applies what clicking the n
+    /// blocks of batch revealed, as GameBackend::click() wrote it, to game
+    /// @param cnt -- the number of entries in revealed, not -1
+    void accio_apply(
+        GameData& game,
+        const Point* batch,
+        int n,
+        const Reveal* revealed,
+        int cnt);
 
     /// @brief The type used to denote probability map
     using MineChance = std::array<int, hash_max>;
 
+    /// @brief Number of cases the counts in a MineChance are out of
+    constexpr int chance_scale = 100000;
+
+    class Arena;
+    class PatternStore;
+    class PatternBuilder;
+
+    /// @brief Enumeration results of parts of the frontier, keyed by the
+    /// signature of their constraints (see GameData::signature)
+    ///
+    /// john() looks up each connected component of the frontier here, and
+    /// the states it meets midway through a search as well, so neither an
+    /// unchanged component nor a repeated sub-state is searched twice.
+    /// The cache holds at most capacity counts and is emptied when full.
+    /// Its memory is kept when emptied, so a cache that has been full once
+    /// makes no more heap allocations.
+    class JohnCache {
+    public:
+        /// @brief Counts of the solutions on n blocks
+        /// ways[j] is the number of solutions with j mines,
+        /// mined[i * (n + 1) + j] the number of those with block i mined
+        struct Entry {
+            int n = 0;
+            std::vector<double> ways, mined;
+        };
+
+        explicit JohnCache(std::size_t capacity = 1 << 22);
+
+        /// @returns the counts under key if they are for n blocks, laid out
+        /// as ways then mined of an Entry, else nullptr
+        /// The pointer is valid until the next insert() or clear()
+        const double* find(std::uint64_t key, int n);
+
+        /// @returns whether find(key, n) would succeed, without counting
+        /// as a hit or a miss
+        bool contains(std::uint64_t key, int n) const noexcept;
+
+        /// @brief Stores the (n + 1)^2 counts at counts, laid out as in
+        /// find(), under key, emptying the cache if it is full
+        void insert(std::uint64_t key, int n, const double* counts);
+
+        /// @brief Drops all entries
+        void clear() noexcept;
+
+        /// @returns the number of successful calls to find()
+        std::size_t hits() const noexcept;
+
+        /// @returns the number of failed calls to find()
+        std::size_t misses() const noexcept;
+
+        /// @brief Makes john() look up components missing from the cache in
+        /// store before searching them, nullptr to stop doing so
+        void use_store(const PatternStore* store) noexcept;
+
+        /// @returns the store set by use_store()
+        const PatternStore* store() const noexcept;
+
+        /// @brief Makes john() add every component it searches to builder,
+        /// nullptr to stop doing so
+        void record_to(PatternBuilder* builder) noexcept;
+
+        /// @returns the builder set by record_to()
+        PatternBuilder* recorder() const noexcept;
+
+    private:
+        // Where the counts under a key are in mCounts
+        struct Slot {
+            int n;
+            std::size_t offset;
+        };
+
+        // Recycles the nodes of mEntries, behind a pointer so the cache
+        // stays movable
+        std::unique_ptr<std::pmr::unsynchronized_pool_resource> mPool;
+        std::pmr::unordered_map<std::uint64_t, Slot> mEntries;
+        // The counts of all entries, one after another
+        std::vector<double> mCounts;
+
+        // Maximum number of counts stored
+        std::size_t mCapacity;
+
+        std::size_t mHits = 0, mMisses = 0;
+
+        const PatternStore* mStore = nullptr;
+        PatternBuilder* mRecorder = nullptr;
+    };
+
     /// @brief Violently BFS and makes move depending on that, deterministic
     ///
     /// This should be the last struggle made against a difficult game,
@@ -66,11 +189,97 @@ namespace Holy {
     /// @param game -- the game data
     /// @returns (false, nullopt) if found a deterministic move
     /// @return Second: A map of Point -> int, showing how many cases in which
-    /// a certain point contains a mine
+    /// a certain point contains a mine, out of chance_scale cases. The
+    /// frontier is counted one component at a time, and components with too
+    /// many cases to enumerate are estimated by sample_front(), in which case
+    /// no deterministic move is made.
     /// @return First: true if john advises to guess, false if not
-    /// @exception This function only transmits exceptions.
-    /// @warning Might call terminate
+    /// @exception std::runtime_error if no layout of mines_left mines
+    /// agrees with the numbers, the moves made before finding out are kept
     std::pair<bool, std::optional<MineChance>> john(GameData& game);
+
+    /// @brief Most unknown blocks endgame() takes on, a bit of a word each
+    constexpr int endgame_max_cells = 64;
+
+    /// @brief Most layouts endgame() enumerates
+    constexpr long long endgame_max_layouts = 1 << 20;
+
+    /// @brief Exact solver for the end of a game
+    ///
+    /// Maps every unknown block to a bit of a word and enumerates the
+    /// layouts of mines_left mines among them with Gosper's hack, checking
+    /// each number with a popcount over the mask of its vacant neighbors.
+    /// Unlike john(), it takes the blocks off the frontier into account, so
+    /// moves that only mines_left allows are found, and every unknown block
+    /// gets its chance. john() hands over to it whenever it applies.
+    /// @returns nullopt if there are more than endgame_max_cells unknown
+    /// blocks or more than endgame_max_layouts layouts to enumerate, else
+    /// the same as john()
+    /// @exception std::runtime_error if no layout fits
+    std::optional<std::pair<bool, std::optional<MineChance>>>
+        endgame(GameData& game);
+
+    /// @brief Same as john(game), with the given cache of earlier searches
+    std::pair<bool, std::optional<MineChance>>
+        john(GameData& game, JohnCache& cache);
+
+    /// @brief Same as john(game, cache), with its scratch memory in arena
+    /// instead of Arena::local(). arena is reset when the call begins.
+    std::pair<bool, std::optional<MineChance>>
+        john(GameData& game, JohnCache& cache, Arena& arena);
+
+    /// @brief Parameters of the frontier sampler
+    struct SamplerConfig {
+        /// Worker threads, each with its own random stream.
+        /// 0 means one per hardware thread.
+        int threads = 0;
+        /// Total walks to make across all workers
+        long long samples = 100000;
+        /// Wall clock limit, the estimate uses whatever was drawn by then.
+        /// 0 means none: the walks stop at samples, so with one thread the
+        /// estimate depends on nothing but the board and the seed.
+        std::chrono::milliseconds budget{ 200 };
+        /// Base seed, worker t uses the stream seeded by (seed, t)
+        unsigned seed = 20201;
+        /// Width of the confidence interval in standard errors
+        double z = 1.96;
+        /// Relative weight of an assignment with k mines, as the rest of the
+        /// board makes some mine counts likelier, the way john() weights
+        /// the counts of a component. Assignments with more mines than it
+        /// covers weigh 0. Empty means all weigh the same, up to mines_left.
+        std::vector<double> mine_weights;
+    };
+
+    /// @brief Probabilities estimated by sample_front()
+    /// All arrays are indexed by Point::hash(), 0 outside the frontier
+    struct ChanceEstimate {
+        /// Estimated probability that the block contains a mine
+        std::array<double, hash_max> chance;
+        /// Lower end of the confidence interval
+        std::array<double, hash_max> low;
+        /// Upper end of the confidence interval
+        std::array<double, hash_max> high;
+        /// Number of walks the estimate is based on
+        long long samples = 0;
+    };
+
+    /// @brief Estimates mine probabilities on a frontier too large to
+    /// enumerate
+    ///
+    /// Makes random walks over front that pick a value for each block among
+    /// those the numbers still allow, and weights each walk by the inverse
+    /// of its probability. Every consistent assignment thus counts equally,
+    /// the same way john() counts them. A walk that runs into a dead end
+    /// scores 0 but still counts toward config.samples.
+    /// @param game -- the game data, not modified
+    /// @param front -- the unknown blocks to sample, as found by john()
+    /// @param config -- time, memory and threading limits
+    /// @returns the estimate, all chances 0 if no walk got through
+    /// @exception This function only transmits exceptions.
+    ChanceEstimate sample_front(
+        const GameData& game,
+        const Frontier& front,
+        const SamplerConfig& config = {});
 } // namespace Holy
 
 #endif
\ No newline at end of file
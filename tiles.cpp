@@ -0,0 +1,233 @@
+#include "tiles.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+    using namespace Holy;
+
+    // The marks staged by a tile
+    using Buffer = std::vector<Mark>;
+
+    constexpr int tiles_x = (col + tile_size - 1) / tile_size;
+    constexpr int tiles_y = (row + tile_size - 1) / tile_size;
+    constexpr int tile_count = tiles_x * tiles_y;
+
+    // Calls fn(p) for the blocks of tile t, tiles and blocks both in the
+    // order roundup() scans the board
+    template <typename Fn>
+    void for_each_in_tile(int t, Fn&& fn) {
+        const int x0 = t / tiles_y * tile_size + 1;
+        const int y0 = t % tiles_y * tile_size + 1;
+        const int x1 = std::min(x0 + tile_size - 1, col);
+        const int y1 = std::min(y0 + tile_size - 1, row);
+        for (int ix = x0; ix <= x1; ix++) {
+            for (int iy = y0; iy <= y1; iy++)
+                fn(Point{ ix, iy });
+        }
+    }
+
+    // The marks roundup() makes for the numbers of tile t
+    void roundup_tile(const GameData& game, int t, Buffer& out) {
+        for_each_in_tile(t, [&](Point p) {
+            const Block& b = game[p];
+            if (b.status != Block::number || b.vacant_nei == 0)
+                return;
+            if (b.elabel != 0 && b.elabel != b.vacant_nei)
+                return;
+            game.for_each_nei8(p, [&](Point np) {
+                if (game[np].status == Block::unknown)
+                    out.push_back({ np, b.elabel != 0 });
+            });
+        });
+    }
+
+    // The marks felix() makes for the centers of tile t
+    void felix_tile(const GameData& game, int t, Buffer& out) {
+        for_each_in_tile(t, [&](Point p) {
+            const Block& b = game[p];
+            if (b.status != Block::number || b.elabel != 1)
+                return;
+            // Vacant blocks p shares with the numbers around it, which are
+            // within 2 of it: share[dx + 2][dy + 2]
+            int share[5][5] = {};
+            game.for_each_nei8(p, [&](Point vacant) {
+                if (game[vacant].status != Block::unknown)
+                    return;
+                game.for_each_nei8(vacant, [&](Point nei2) {
+                    if (nei2 != p && game[nei2].status == Block::number)
+                        share[nei2.x - p.x + 2][nei2.y - p.y + 2]++;
+                });
+            });
+            // The first second neighbor felix() would take
+            for (int dx = -2; dx <= 2; dx++) {
+                for (int dy = -2; dy <= 2; dy++) {
+                    const int shared = share[dx + 2][dy + 2];
+                    if (shared == 0)
+                        continue;
+                    const Point nei2{ p.x + dx, p.y + dy };
+                    const int kept = game[nei2].vacant_nei - shared;
+                    if (kept + 1 != game[nei2].elabel)
+                        continue;
+                    if (kept == 0 && shared == b.vacant_nei)
+                        continue;
+                    // Kept back by nei2: mines, the rest around p: safe
+                    game.for_each_nei8(nei2, [&](Point np) {
+                        if (game[np].status == Block::unknown
+                            && std::max(std::abs(np.x - p.x),
+                                   std::abs(np.y - p.y))
+                                > 1)
+                            out.push_back({ np, true });
+                    });
+                    game.for_each_nei8(p, [&](Point np) {
+                        if (game[np].status == Block::unknown
+                            && std::max(std::abs(np.x - nei2.x),
+                                   std::abs(np.y - nei2.y))
+                                > 1)
+                            out.push_back({ np, false });
+                    });
+                    return;
+                }
+            }
+        });
+    }
+
+    // Applies the buffers in one batch, skipping marks already made or
+    // staged by an earlier tile
+    // Returns whether a block changed
+    bool commit(GameData& game, const std::vector<Buffer>& buffers) {
+        Buffer batch;
+        // Staged blocks, and which of them are mines
+        Checklist staged, mined;
+        for (const auto& buffer : buffers) {
+            for (const auto& [p, mine] : buffer) {
+                const auto status = game[p].status;
+                if (status == Block::unknown && !staged[p.hash()]) {
+                    staged[p.hash()] = true;
+                    mined[p.hash()] = mine;
+                    batch.push_back({ p, mine });
+                } else if (status == Block::unknown
+                    ? mined[p.hash()] != mine
+                    : (status == Block::mine) != mine) {
+                    throw std::runtime_error("Tiles disagree on a block");
+                }
+            }
+        }
+        game.mark_batch(batch.data(), batch.size());
+        return !batch.empty();
+    }
+
+    // Proposes with propose(game, t, buffer) on every tile and commits,
+    // until nothing changes
+    template <typename Propose>
+    bool rounds(GameData& game, TilePool& pool, Propose&& propose) {
+        std::vector<Buffer> buffers(tile_count);
+        const std::function<void(int)> job = [&](int t) {
+            buffers[t].clear();
+            propose(game, t, buffers[t]);
+        };
+        bool ret = false;
+        while (true) {
+            pool.run(tile_count, job);
+            if (!commit(game, buffers))
+                return ret;
+            ret = true;
+        }
+    }
+} // namespace
+
+namespace Holy {
+    TilePool::TilePool(int threads) {
+        if (threads < 0)
+            threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        for (int t = 0; t < threads; t++)
+            mThreads.emplace_back([this] { loop(); });
+    }
+
+    TilePool::~TilePool() noexcept {
+        {
+            std::lock_guard lock(mMutex);
+            mStop = true;
+        }
+        mStart.notify_all();
+        for (auto& th : mThreads)
+            th.join();
+    }
+
+    void TilePool::run(int n, const std::function<void(int)>& fn) {
+        if (n <= 0)
+            return;
+        {
+            std::lock_guard lock(mMutex);
+            mJob = &fn;
+            mCount = n;
+            mNext = 0;
+            mPending = n;
+            mGeneration++;
+        }
+        mStart.notify_all();
+        work();
+        std::exception_ptr error;
+        {
+            std::unique_lock lock(mMutex);
+            mDone.wait(lock, [this] { return mPending == 0; });
+            mJob = nullptr;
+            std::swap(error, mError);
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    int TilePool::size() const noexcept {
+        return mThreads.size() + 1;
+    }
+
+    void TilePool::work() {
+        while (true) {
+            const std::function<void(int)>* job;
+            int i;
+            {
+                std::lock_guard lock(mMutex);
+                if (mNext >= mCount)
+                    return;
+                i = mNext++;
+                job = mJob;
+            }
+            // Such as bad_alloc from a Buffer, kept for run() to rethrow
+            std::exception_ptr error;
+            try {
+                (*job)(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard lock(mMutex);
+            if (error && !mError)
+                mError = error;
+            if (--mPending == 0)
+                mDone.notify_all();
+        }
+    }
+
+    void TilePool::loop() {
+        long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mMutex);
+                mStart.wait(
+                    lock, [&] { return mStop || mGeneration != seen; });
+                if (mStop)
+                    return;
+                seen = mGeneration;
+            }
+            work();
+        }
+    }
+
+    bool roundup(GameData& game, TilePool& pool) {
+        return rounds(game, pool, roundup_tile);
+    }
+
+    bool felix(GameData& game, TilePool& pool) {
+        return rounds(game, pool, felix_tile);
+    }
+} // namespace Holy
@@ -0,0 +1,93 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include "solvers.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/// @file tiles.h Tile-parallel versions of roundup() and felix()
+/// The board is cut into square tiles that a pool of threads works on at
+/// once. A tile only reads the board and stages the marks its numbers call
+/// for in a buffer of its own; the buffers are then committed one tile
+/// after another, in board order. No two threads ever write the same
+/// counters, and the outcome does not depend on the number of threads.
+/// These are for benchmarking only. The scheduler runs the serial
+/// roundup() and felix(), and tiles_bench is the one caller here, checking
+/// and timing them against the serial solvers.
+
+namespace Holy {
+    /// @brief Side of a tile, in blocks
+    constexpr int tile_size = 8;
+
+    /// @brief A fixed pool of threads running a function over an index range
+    class TilePool {
+    public:
+        /// @param threads -- threads besides the caller's, which takes part
+        /// in run(); -1 means one per hardware thread in total
+        explicit TilePool(int threads = -1);
+
+        // Copy operations are not permitted.
+        TilePool(const TilePool& src) = delete;
+
+        // Copy operations are not permitted.
+        TilePool& operator=(const TilePool& src) = delete;
+
+        // Stops and joins the threads
+        ~TilePool() noexcept;
+
+        /// @brief Calls fn(i) for every i in [0, n), spread over the
+        /// threads, and returns once all calls are done
+        /// @exception the first exception a call of fn threw, rethrown once
+        /// all calls are done
+        void run(int n, const std::function<void(int)>& fn);
+
+        /// @returns the number of threads, the caller's included
+        int size() const noexcept;
+
+    private:
+        // Takes indices of the current job until there are none left
+        void work();
+
+        // Body of each thread
+        void loop();
+
+        std::vector<std::thread> mThreads;
+        std::mutex mMutex;
+        std::condition_variable mStart, mDone;
+        // The current job, valid while mPending > 0
+        const std::function<void(int)>* mJob = nullptr;
+        int mCount = 0, mNext = 0, mPending = 0;
+        // The first exception thrown by the current job
+        std::exception_ptr mError;
+        // Bumped for every job, so a thread runs each job once
+        long long mGeneration = 0;
+        bool mStop = false;
+    };
+
+    /// @brief roundup() run until it makes no move, a tile per task
+    ///
+    /// Within a round every number reads the board as the round found it,
+    /// so a round may make fewer moves than a pass of roundup(), but the
+    /// board ends up the same as after `while (roundup(game));`.
+    /// @returns true if a move was made
+    /// @exception std::runtime_error if two tiles disagree on a block,
+    /// which only happens on boards no layout fits
+    bool roundup(GameData& game, TilePool& pool);
+
+    /// @brief felix() run until it makes no move, a tile per task
+    ///
+    /// A center picks its second neighbor as felix() does. Rounds are
+    /// repeated like in roundup(game, pool). On its own it may stop
+    /// elsewhere than repeated felix(), whose moves depend on the order
+    /// centers are visited in, but roundup(game, pool) then
+    /// felix(game, pool) in turn until neither moves end where roundup()
+    /// then felix() in turn do.
+    /// @returns true if a move was made
+    /// @exception std::runtime_error as roundup(game, pool)
+    bool felix(GameData& game, TilePool& pool);
+} // namespace Holy
+
+#endif // TILES_H
@@ -0,0 +1,96 @@
+// Contains main()
+// Checks and times the tile-parallel roundup() and felix() of tiles.h
+// Usage: tiles_bench [positions] [seed] [threads]
+//     positions -- 2000 by default
+//     threads   -- one per hardware thread by default
+// The positions met in seeded games are each brought to the fixpoint of
+// roundup(), and of roundup() and felix() in turn, serially and by tiles.
+// The boards should end up the same: exits with 2 if any two differ.
+#include "generator.h"
+#include "tiles.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace Holy;
+
+namespace {
+    // Whether the solvers see a and b the same
+    bool same_board(const GameData& a, const GameData& b) {
+        if (a.mines_left != b.mines_left || a.signature != b.signature)
+            return false;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Block &x = a[{ ix, iy }], &y = b[{ ix, iy }];
+                if (x.status != y.status || x.elabel != y.elabel
+                    || x.vacant_nei != y.vacant_nei)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns whether the boards all ended up the same
+    bool run_tiles(long long count, unsigned seed, int threads) {
+        using namespace std::chrono;
+        std::vector<GameData> positions;
+        Butterfly butt;
+        for (unsigned g = 0; (long long)positions.size() < count; g++) {
+            std::seed_seq seq{ seed, g };
+            std::mt19937 rng(seq);
+            butt.start_game({ 10, 10 }, draw_layout({ 10, 10 }, rng));
+            GameData game;
+            game.mark_semiknown({ 10, 10 });
+            accio(game, butt, true);
+            while ((long long)positions.size() < count) {
+                positions.push_back(game);
+                if (!(roundup(game) || window(game) || felix(game))
+                    && john(game).second)
+                    break;
+                accio(game, butt, true);
+                if (butt.verify())
+                    break;
+            }
+        }
+        TilePool pool(threads > 0 ? threads - 1 : -1);
+        std::cout << positions.size() << " positions, " << pool.size()
+                  << " threads\n";
+        bool ret = true;
+        for (const bool with_felix : { false, true }) {
+            long long differ = 0;
+            nanoseconds serial_ns{ 0 }, tiled_ns{ 0 };
+            for (const auto& position : positions) {
+                GameData serial = position, tiled = position;
+                auto start = steady_clock::now();
+                if (with_felix) {
+                    while (roundup(serial) || felix(serial)) {}
+                } else {
+                    while (roundup(serial)) {}
+                }
+                serial_ns += steady_clock::now() - start;
+                start = steady_clock::now();
+                if (with_felix) {
+                    while (roundup(tiled, pool) || felix(tiled, pool)) {}
+                } else {
+                    roundup(tiled, pool);
+                }
+                tiled_ns += steady_clock::now() - start;
+                differ += !same_board(serial, tiled);
+            }
+            const double n = positions.size();
+            std::cout << "    " << (with_felix ? "roundup+felix" : "roundup")
+                      << ": boards differ " << differ << "    serial "
+                      << serial_ns.count() / 1000 / n << "us    tiles "
+                      << tiled_ns.count() / 1000 / n << "us per position\n";
+            ret = ret && differ == 0;
+        }
+        return ret;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    const bool same = run_tiles(argc > 1 ? std::atoll(argv[1]) : 2000,
+        argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20201,
+        argc > 3 ? std::atoi(argv[3]) : 0);
+    return same ? 0 : 2;
+}
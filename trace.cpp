@@ -0,0 +1,125 @@
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    using namespace Holy;
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        const char* name;
+        // Since origin
+        long long ns;
+        bool begin;
+    };
+
+    // The events of a thread, kept by the registry past the thread's end
+    struct Buffer {
+        int tid;
+        std::vector<Event> events;
+    };
+
+    // Timestamps count from here
+    const Clock::time_point origin = Clock::now();
+
+    // Guards everything below
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    std::set<std::string> names;
+    std::string out_path;
+
+    Buffer& local_buffer() {
+        thread_local Buffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard lock(registry_mutex);
+            buffers.push_back(std::make_unique<Buffer>());
+            buffer = buffers.back().get();
+            buffer->tid = buffers.size();
+        }
+        return *buffer;
+    }
+
+    // Writes s as a JSON string
+    void write_string(std::ostream& out, const char* s) {
+        out << '"';
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\') {
+                out << '\\' << *s;
+            } else if ((unsigned char)*s < 0x20) {
+                char esc[8];
+                std::snprintf(esc, sizeof esc, "\\u%04x", *s);
+                out << esc;
+            } else {
+                out << *s;
+            }
+        }
+        out << '"';
+    }
+} // namespace
+
+namespace Holy {
+    namespace trace {
+        std::atomic<bool> recording{ false };
+
+        void start(const std::string& path) {
+            std::lock_guard lock(registry_mutex);
+            for (auto& buffer : buffers)
+                buffer->events.clear();
+            out_path = path;
+            recording.store(true);
+        }
+
+        void stop() {
+            recording.store(false);
+            std::lock_guard lock(registry_mutex);
+            if (out_path.empty())
+                return;
+            std::ofstream out(out_path);
+            out << "{\"traceEvents\":[";
+            bool first = true;
+            for (auto& buffer : buffers) {
+                for (const auto& e : buffer->events) {
+                    out << (first ? "\n" : ",\n") << "{\"name\":";
+                    write_string(out, e.name);
+                    // Microseconds, to the nanosecond
+                    char ts[32];
+                    std::snprintf(ts, sizeof ts, "%lld.%03lld", e.ns / 1000,
+                        e.ns % 1000);
+                    out << ",\"ph\":\"" << (e.begin ? 'B' : 'E')
+                        << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":"
+                        << buffer->tid << '}';
+                    first = false;
+                }
+                buffer->events.clear();
+            }
+            out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+            out.close();
+            if (!out)
+                throw std::runtime_error(
+                    "Cannot write the trace to " + out_path);
+            out_path.clear();
+        }
+
+        const char* intern(const std::string& name) {
+            std::lock_guard lock(registry_mutex);
+            return names.insert(name).first->c_str();
+        }
+
+        void Span::record(const char* name, bool begin) noexcept {
+            using namespace std::chrono;
+            const long long ns =
+                duration_cast<nanoseconds>(Clock::now() - origin).count();
+            try {
+                local_buffer().events.push_back({ name, ns, begin });
+            } catch (const std::bad_alloc&) {
+                // Lose the event rather than the run
+            }
+        }
+    } // namespace trace
+} // namespace Holy
@@ -0,0 +1,63 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <string>
+
+/// @file trace.h A timeline of where the time goes within a game
+/// Spans record a begin and an end event, with a nanosecond timestamp, in a
+/// buffer of their thread's own. stop() writes them all out in the Chrome
+/// trace event format, which chrome://tracing and Perfetto open. Until
+/// start() is called a span costs a relaxed load and a branch.
+
+namespace Holy {
+    namespace trace {
+        /// @brief Whether spans are being recorded
+        extern std::atomic<bool> recording;
+
+        /// @brief Starts recording, for stop() to write to path
+        /// Events recorded before are dropped.
+        void start(const std::string& path);
+
+        /// @brief Stops recording and writes the events to the path given
+        /// to start(), if it was called
+        /// Threads are not to record while it runs.
+        /// @exception std::runtime_error if the file cannot be written
+        void stop();
+
+        /// @returns a copy of name that lives as long as the program, for
+        /// names of spans that do not
+        const char* intern(const std::string& name);
+
+        /// @brief Records a begin event now and an end event on destruction
+        class Span {
+        public:
+            /// @param name -- must outlive the recording, see intern()
+            explicit Span(const char* name) noexcept :
+                mName(recording.load(std::memory_order_relaxed) ? name
+                                                                : nullptr) {
+                if (mName)
+                    record(mName, true);
+            }
+
+            // Copy operations are not permitted.
+            Span(const Span& src) = delete;
+
+            // Copy operations are not permitted.
+            Span& operator=(const Span& src) = delete;
+
+            ~Span() noexcept {
+                if (mName)
+                    record(mName, false);
+            }
+
+        private:
+            // Appends an event to the buffer of this thread
+            static void record(const char* name, bool begin) noexcept;
+
+            const char* mName;
+        };
+    } // namespace trace
+} // namespace Holy
+
+#endif // TRACE_H
@@ -0,0 +1,158 @@
+#include "solvers.h"
+#include <array>
+#include <cstdint>
+
+// The deductions a pair of numbers allows depend only on their effective
+// labels a and b and on how their vacant neighbors split: p next to the
+// first only, s next to both and q next to the second only. Blocks in one
+// of these parts are interchangeable, so a part is either forced as a whole
+// or not at all. Whatever the window around the pair looks like, it packs
+// into one of 9^5 indices, and the table below, evaluated by the compiler,
+// holds the forced parts of each.
+
+namespace {
+    using namespace Holy;
+
+    constexpr int pair_count = 9 * 9 * 9 * 9 * 9;
+
+    constexpr int pair_index(int a, int b, int p, int s, int q) noexcept {
+        return (((a * 9 + b) * 9 + p) * 9 + s) * 9 + q;
+    }
+
+    // Bits of a table entry, one pair per part: all mines, all safe
+    enum Forced : std::uint8_t {
+        first_mine = 1,
+        first_safe = 2,
+        shared_mine = 4,
+        shared_safe = 8,
+        second_mine = 16,
+        second_safe = 32
+    };
+
+    struct PairTable {
+        std::uint8_t forced[pair_count]{};
+    };
+
+    // Tries every number k of mines among the shared blocks. Entries with
+    // no solution at all are left 0, as are parts with no block.
+    constexpr PairTable make_table() {
+        PairTable table;
+        for (int i = 0; i < pair_count; i++) {
+            const int q = i % 9, s = i / 9 % 9, p = i / 81 % 9;
+            const int b = i / 729 % 9, a = i / 6561;
+            // No number has more than 8 vacant neighbors
+            if (p + s > 8 || s + q > 8)
+                continue;
+            bool any = false;
+            bool first_full = true, first_empty = true;
+            bool shared_full = true, shared_empty = true;
+            bool second_full = true, second_empty = true;
+            for (int k = 0; k <= s; k++) {
+                const int ra = a - k, rb = b - k;
+                if (ra < 0 || ra > p || rb < 0 || rb > q)
+                    continue;
+                any = true;
+                first_full = first_full && ra == p;
+                first_empty = first_empty && ra == 0;
+                shared_full = shared_full && k == s;
+                shared_empty = shared_empty && k == 0;
+                second_full = second_full && rb == q;
+                second_empty = second_empty && rb == 0;
+            }
+            if (!any)
+                continue;
+            int code = 0;
+            if (p > 0) {
+                code |= (first_full ? first_mine : 0)
+                    | (first_empty ? first_safe : 0);
+            }
+            if (s > 0) {
+                code |= (shared_full ? shared_mine : 0)
+                    | (shared_empty ? shared_safe : 0);
+            }
+            if (q > 0) {
+                code |= (second_full ? second_mine : 0)
+                    | (second_empty ? second_safe : 0);
+            }
+            table.forced[i] = code;
+        }
+        return table;
+    }
+
+    constexpr PairTable table = make_table();
+
+    // 1-2 against a wall: the block only the 2 sees is a mine
+    static_assert(table.forced[pair_index(1, 2, 0, 2, 1)] == second_mine);
+    // 1-1 with the second 1 seeing everything the first sees
+    static_assert(table.forced[pair_index(1, 1, 0, 2, 1)] == second_safe);
+
+    // Whether p and q are neighbors
+    bool touches(Point p, Point q) noexcept {
+        return -1 <= p.x - q.x && p.x - q.x <= 1 && -1 <= p.y - q.y
+            && p.y - q.y <= 1;
+    }
+
+    // Looks up the pair of numbers u and v, whose vacant neighbors may
+    // overlap, and marks the parts it forces
+    bool do_pair(GameData& game, Point u, Point v) {
+        const Block& bu = game[u];
+        const Block& bv = game[v];
+        if (bv.status != Block::number || !bv.second_init
+            || bv.vacant_nei == 0 || bu.vacant_nei == 0)
+            return false;
+        // Negative only on boards no layout fits
+        if (bu.elabel < 0 || bv.elabel < 0)
+            return false;
+        Point parts[3][8];
+        int n[3] = {};
+        game.for_each_nei8(u, [&](Point np) {
+            if (game[np].status == Block::unknown) {
+                const int k = touches(np, v) ? 1 : 0;
+                parts[k][n[k]++] = np;
+            }
+        });
+        const int q = bv.vacant_nei - n[1];
+        const int code =
+            table.forced[pair_index(bu.elabel, bv.elabel, n[0], n[1], q)];
+        if (code == 0)
+            return false;
+        game.for_each_nei8(v, [&](Point np) {
+            if (game[np].status == Block::unknown && !touches(np, u))
+                parts[2][n[2]++] = np;
+        });
+        // The parts in the order of the bits of Forced
+        std::array<Mark, 16> marks;
+        int cnt = 0;
+        for (int k = 0; k < 3; k++) {
+            for (int i = 0; i < n[k]; i++) {
+                if (code >> (2 * k) & 3)
+                    marks[cnt++] = { parts[k][i], bool(code >> (2 * k) & 1) };
+            }
+        }
+        game.mark_batch(marks.data(), cnt);
+        return true;
+    }
+} // namespace
+
+namespace Holy {
+    bool window(GameData& game) {
+        bool ret = false;
+        for (int ix = 1; ix <= col; ix++) {
+            for (int iy = 1; iy <= row; iy++) {
+                const Point u{ ix, iy };
+                const Block& bu = game[u];
+                if (bu.status != Block::number || !bu.second_init)
+                    continue;
+                // Every pair once: v comes after u in this scan
+                for (int dx = 0; dx <= 2 && bu.vacant_nei > 0; dx++) {
+                    for (int dy = dx ? -2 : 1; dy <= 2; dy++) {
+                        const Point v{ ix + dx, iy + dy };
+                        if (v.valid())
+                            ret = do_pair(game, u, v) || ret;
+                    }
+                }
+            }
+        }
+        return ret;
+    }
+} // namespace Holy